@@ -1,23 +1,139 @@
 #include <stdio.h>
 #include <stdlib.h>
+#include <stdarg.h>
 #include <string.h>
+#include <errno.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <limits.h>
 #include <time.h>
+#include <math.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <dirent.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#ifdef HAVE_ZSTD
+#include <zstd.h>
+#endif
 
 #define MAX_SAVED_GAMES 20
 #define MAX_FILENAME_LENGTH 256
 #define MAX_INVENTORY 15
 #define MAX_COMMAND_LENGTH 256
-#define MAX_ITEMS 10
-#define MAP_SIZE 5
+#define MAX_ITEMS 10         // Per-room item limit of the legacy benchmark layout
+#ifndef MAP_SIZE
+#define MAP_SIZE 5           // Side of each floor; build with -DMAP_SIZE=N for larger maps
+#endif
 #define MAX_ROOMS 10
-#define FIXED_CREATURE_COUNT 5
-int creatures_left = FIXED_CREATURE_COUNT;
-int discovered[MAP_SIZE][MAP_SIZE] = {0};
+#define FIXED_CREATURE_COUNT 5     // Built-in creature count; content packs may change it
+#define MAP_CHUNK_SIZE 8    // Exploration chunks are 8x8 cells, one bit per cell
+#define MAP_CHUNKS ((MAP_SIZE + MAP_CHUNK_SIZE - 1) / MAP_CHUNK_SIZE)
+#define MAP_VIEW_RADIUS 7   // Cells shown around the player on large maps
+#define MAP_CELL_WIDTH 3    // Characters per rendered map cell, e.g. "[R]"
+#define NO_ID (-1)          // Empty room, item or creature handle
+#define ITEM_INDEX_MIN_CAPACITY 16  // Initial slots of the room item name index
+#define STRING_PAGE_SIZE 1024       // Interned strings per page of the id table
+#define STRING_MAX_PAGES 4096
+#define STRING_BLOCK_SIZE 65536     // Bytes per block of interned string storage
+#define BENCH_DEFAULT_ROOMS 100000
+#define BENCH_FLOORS 200
+#define BENCH_FLOOR_PLAY_US 1000    // Time spent on each floor of the streaming benchmark
+#define AUTOSAVE_QUEUE_DEPTH 2      // Pending snapshots before saving blocks the game loop
+#define AUTOSAVE_INTERVAL 20        // Commands between periodic autosaves
+#define COMPRESSED_SAVE_EXTENSION ".dz"  // Save paths ending in this are compressed
+#define SAVE_MAGIC "DSAV"           // First bytes of a compressed save
+#define SAVE_MAGIC_SIZE 4
+#define SAVE_FORMAT_VERSION 2        // 2 added the floor fields
+#define SAVE_CHUNK_SIZE 65536       // Uncompressed bytes per compressed save chunk
+#define SAVE_CHUNK_HEADER_SIZE 9
+#define SAVE_MATCH_HASH_BITS 14     // Slots of the LZ match finder, as a power of two
+#define SAVE_MAX_TEXT 255           // Longest string in a compressed save, as in a text save line
+#define SAVE_MAX_STAT 1000000       // Largest health, strength or item bonus; a full inventory's total fits an int
+#define SAVE_CODEC_STORED 0
+#define SAVE_CODEC_LZ 1
+#define SAVE_CODEC_ZSTD 2
+#ifdef HAVE_ZSTD
+#define SAVE_PACKED_CAPACITY ZSTD_COMPRESSBOUND(SAVE_CHUNK_SIZE)
+#else
+#define SAVE_PACKED_CAPACITY SAVE_CHUNK_SIZE
+#endif
+#define SAVE_RECORD_ROOM 'R'        // Record tags of the compressed save stream
+#define SAVE_RECORD_DISCOVERED 'D'
+#define SAVE_RECORD_END 'E'
+#define LOAD_ERROR_LENGTH 256
+#define WHEEL_BITS 6                 // Timer wheel: 64 slots per level, each level 64 times coarser
+#define WHEEL_SLOTS (1 << WHEEL_BITS)
+#define WHEEL_LEVELS 4               // Reaches 2^24 ticks; later events go round again
+#define EVENT_WANDER 0               // World event kinds
+#define EVENT_RESPAWN 1
+#define PACK_MAX_CREATURES 10000     // Most creatures a content pack may place
+#define CONTENT_PACK_PATH "content.dpk"  // Compiled content pack loaded at startup, if present
+#define PACK_MAGIC "DPAK"
+#define PACK_FORMAT_VERSION 4        // 4 dropped regen_interval
+#define PACK_MAX_PREFIX 16           // Longest item, creature or award name prefix
+#define PACK_MAX_FLOORS 1000         // Deepest dungeon a content pack may stack
+#define FLOOR_MAX_RESIDENT 5         // Floors in memory before a floor change waits for writes
+#define FLOOR_DIR_TEMPLATE "dungeon_floors_XXXXXX"  // Session directory of floor files, for mkdtemp
+#define FLOOR_NEW 0                  // Floor states: never generated
+#define FLOOR_CURRENT 1              // The player's floor, held by the game loop
+#define FLOOR_RESIDENT 2             // In memory next to the current floor
+#define FLOOR_STORED 3               // In its floor file
+#define FLOOR_LOADING 4              // Being read by the streamer thread
+#define FLOOR_STORING 5              // Being written by the streamer thread
+#define FLOOR_JOB_STORE 0            // Streamer jobs: write a floor out and free it
+#define FLOOR_JOB_LOAD 1             // Read a floor back in
+#define FLOOR_JOB_EXPORT 2           // Write a copy of a floor beside a save
+#define FLOOR_JOB_LINK 3             // Link a stored floor's file beside a save
+#define CHECK_MAX_THREADS 64         // Upper bound on save checker threads
+#define STEP_BLOCKED (-1)            // Rule step results: not possible here, nothing changed
+#define STEP_DONE 0
+#define STEP_WON 1
+#define STEP_LOST 2
+#define BOT_UP 0                     // Bot actions; the four moves come first
+#define BOT_DOWN 1
+#define BOT_LEFT 2
+#define BOT_RIGHT 3
+#define BOT_PICKUP 4
+#define BOT_ATTACK 5
+#define BOT_RETURN 6                 // Walk back to the starting room
+#define BOT_STAIRS 7                 // Take the stairs down, or up from the starting room
+#define BOT_ACTIONS 8
+#define BOT_DEFAULT_ROLLOUTS 1000    // Rollouts per bot decision
+#define BOT_TREE_DEPTH 64            // Deepest path followed inside a search tree
+#define BOT_ROLLOUT_DEPTH 60         // Actions simulated past the tree per rollout
+#define BOT_EXPLORATION 1.0          // UCB1 exploration constant
+#define BOT_MAX_ACTIONS 400          // Actions per floor before the bot gives up on a game
+#define BOT_MAX_THREADS 64
+#define MEM_ROOMS 0                  // Allocation tags of the tracking allocator
+#define MEM_ITEMS 1                  // Item pool and name index
+#define MEM_CREATURES 2
+#define MEM_EVENTS 3
+#define MEM_NAMES 4                  // String table: names and descriptions
+#define MEM_WORLDS 5                 // World structs off the stack, floor table and floor jobs
+#define MEM_SAVES 6                  // Save snapshots, streams and buffers
+#define MEM_CONTENT 7                // Built-in content pack and the pack compiler
+#define MEM_BOT 8
+#define MEM_TAGS 9
+
+// Cached map frame; only dirty rows are re-rendered on redraw
+typedef struct MapFrame {
+    char rows[MAP_SIZE][MAP_SIZE * MAP_CELL_WIDTH + 1];
+    unsigned char dirty[MAP_SIZE];
+    uint64_t discovered[MAP_CHUNKS][MAP_CHUNKS];  // Exploration bits the cached rows show
+    int player_x, player_y;  // Player position in the cached frame
+    int valid;               // 0 forces a full re-render
+} MapFrame;
+MapFrame map_frame = { .valid = 0 };
 
 // Array of saved game file names
 char saved_games[MAX_SAVED_GAMES][MAX_FILENAME_LENGTH];
 int saved_game_count = 0;
 
+int game_over = 0;  // Set when the game is won, lost or exited; ends the game loop
+
 // Predefined unique room descriptions
 const char *room_descriptions[] = {
     "A dimly lit chamber with moss-covered walls.",
@@ -34,79 +150,395 @@ const char *room_descriptions[] = {
 #define TOTAL_DESCRIPTIONS (sizeof(room_descriptions) / sizeof(room_descriptions[0]))
 
 // Struct Definitions
-typedef struct Item {
-    char *name;
-    int attack_bonus;
-    int shield_bonus;
-} Item;
 
-typedef struct Creature {
-    char *name;
-    int health;
-    int strength;
-} Creature;
+// Header of a compiled content pack. Strings are NUL-terminated and
+// addressed by byte offsets from the start of the pack, so a mapped pack
+// is used in place. Ranges are inclusive {min, max}.
+typedef struct PackHeader {
+    char magic[4];
+    uint32_t version;
+    uint32_t size;                 // Total bytes, header included
+    uint32_t description_count;
+    uint32_t descriptions;         // Offset of the description string offsets
+    uint32_t start_description;    // String offsets
+    uint32_t item_name, creature_name, award_name;  // Name prefixes
+    int32_t creature_count;
+    int32_t item_chance;           // Percent of rooms given an item
+    int32_t item_attack[2], item_shield[2];
+    int32_t creature_health[2], creature_strength[2];
+    int32_t award_attack[2], award_shield[2];
+    int32_t award_variants;        // Distinct award names
+    int32_t wander_interval[2];    // Ticks between a creature's moves
+    int32_t respawn_delay[2];      // Ticks until a defeated creature returns; {0, 0} never
+    int32_t floor_count;           // Floors of a new dungeon
+} PackHeader;
+const PackHeader *content = NULL;  // The pack in use
+int content_mapped = 0;            // 1 if content is a mapped file
 
-typedef struct Room {
-    int id;
-    char *description;
-    Item *items[MAX_ITEMS];
-    int item_count;
-    Creature *creature;
-    int x, y;          // Map position
-    int discovered;    // Room discovered?
-} Room;
+// Global intern table: each distinct description or name is stored once and
+// referred to by a compact integer id. Pages and storage blocks never move,
+// so the text of an id stays valid while the table grows.
+typedef struct StringTable {
+    const char **pages[STRING_MAX_PAGES];  // Id -> text
+    int count;
+    char **blocks;                         // Character storage
+    int block_count;
+    size_t block_used;                     // Bytes used in the last block
+    int *slots;                            // Hash set of ids, NO_ID if empty
+    uint32_t *slot_hash;
+    int slot_capacity;                     // Power of two
+    pthread_mutex_t lock;                  // Serializes interning; ids are read without it
+} StringTable;
+StringTable strings = { .lock = PTHREAD_MUTEX_INITIALIZER };
+
+// The world is stored as parallel arrays. Rooms, items and creatures are
+// addressed by integer handles (array indices); freed item and creature
+// slots go on a free list, so live handles never move.
+typedef struct World {
+    // Rooms, indexed by room id
+    int room_count;
+    int room_capacity;
+    int *room_x, *room_y;          // Map position
+    int *room_description;         // String id
+    int *room_item_count;
+    int *room_first_item;          // Head of the room's item list, NO_ID if empty
+    int *room_last_item;           // Tail, so new items are appended in order
+    int *room_creature_count;
+    int *room_first_creature;      // Head of the room's creature list, NO_ID if empty
+    int *room_last_creature;
+
+    // Item pool
+    int item_count;                // Slots handed out, including freed ones
+    int item_capacity;
+    int item_free;                 // Head of the free slot list
+    int *item_name;                // String id, NO_ID for a free slot
+    int *item_attack, *item_shield;
+    unsigned char *item_award;     // 1 for awards, so win checks don't read name text
+    int *item_room;                // Room holding the item, NO_ID if carried
+    int *item_prev, *item_next;    // Links in the holding room's item list
+    int *item_next_free;
+
+    // Name index over items lying in rooms: open addressing keyed by
+    // (room, name), so pickups don't scan the room
+    int item_index_capacity;       // Power of two
+    int item_index_count;
+    int *item_index;               // Item handle per slot, NO_ID if empty
+    uint32_t *item_index_hash;
+
+    // Creature pool
+    int creature_count;
+    int creature_capacity;
+    int creature_free;
+    int *creature_name;            // String id, NO_ID for a free slot
+    int *creature_health, *creature_strength;
+    int *creature_room;            // Room the creature is in, NO_ID if none
+    int *creature_prev, *creature_next;  // Links in the room's creature list
+    int *creature_next_free;
+    int *creature_generation;      // Bumped when the slot is freed, so old events go stale
+
+    // Event pool and timer wheel. An event waits in one wheel slot's list,
+    // linked through event_next, which also links the free list.
+    int tick;                      // Commands the world has seen
+    int wheel[WHEEL_LEVELS][WHEEL_SLOTS];  // Head of each slot's list, NO_ID if empty
+    int event_count;
+    int event_capacity;
+    int event_free;
+    int event_pending;             // Events scheduled and not yet fired
+    long long events_fired;
+    int *event_kind;
+    int *event_target;             // Creature, or NO_ID
+    int *event_generation;         // The target's generation when scheduled
+    int *event_due;                // Tick the event fires on
+    int *event_next;
+
+    int cell_room[MAP_SIZE][MAP_SIZE];  // Room id at each cell, NO_ID if empty
+
+    // Session progress, kept here so a copied world is a complete game state
+    uint64_t discovered[MAP_CHUNKS][MAP_CHUNKS];  // One 64-bit mask per map chunk
+    int creatures_left;
+
+    // Place in the dungeon; a world is one floor
+    int floor;                     // 0 for the top floor
+    int floor_count;
+    int stairs_room;               // Room with the stairs down, NO_ID on the bottom floor
+    int floors_unfinished;         // Other floors with creatures or awards left
+} World;
 
 typedef struct Player {
-    char nickname[50];  
+    char nickname[50];
     int health;
     int base_strength;
-    Item *inventory[MAX_INVENTORY];
+    int inventory[MAX_INVENTORY];  // Item handles
     int inventory_count;
-    int x, y;  
+    int x, y;
 } Player;
 
+// Everything a save file records, copied so it can be written off-thread
+typedef struct SaveSnapshot {
+    Player player;
+    World world;
+    int string_count;              // Strings interned when the snapshot was taken
+} SaveSnapshot;
+
+// Size of one save file, for throughput and compression reports
+typedef struct SaveSize {
+    long long raw_bytes;           // Record stream before compression
+    long long file_bytes;          // Bytes on disk
+    int compressed;
+} SaveSize;
+
+typedef struct SaveJob {
+    SaveSnapshot state;
+    char filepath[MAX_FILENAME_LENGTH];
+    int announce;                  // Report success to the player; failures always are
+} SaveJob;
+
+// Background autosave: the game loop queues world snapshots and a single
+// worker thread serializes them. Queuing blocks while the queue is full.
+typedef struct Autosave {
+    pthread_t thread;
+    pthread_mutex_t lock;
+    pthread_cond_t job_ready;      // Signalled when a job is queued or on shutdown
+    pthread_cond_t job_done;       // Signalled when the worker finishes a job
+    SaveJob *queue[AUTOSAVE_QUEUE_DEPTH];
+    int queue_head, queue_count;
+    int busy;                      // Worker is writing a job
+    int started, stopping;
+    int commands_since_save;
+
+    // Telemetry
+    int snapshots, saves_written, saves_failed, stalls;
+    double pause_total, pause_max; // Snapshot time spent in the game loop
+    double write_total, write_max; // Serialization and disk time on the worker
+    double stall_total;            // Game loop time blocked on a full queue
+    int compressed_saves;
+    long long compressed_raw, compressed_file;
+    double compressed_seconds;
+
+    // Finished saves not yet reported to the player
+    char finished[AUTOSAVE_QUEUE_DEPTH * 2][MAX_FILENAME_LENGTH];
+    int finished_ok[AUTOSAVE_QUEUE_DEPTH * 2];
+    char finished_error[AUTOSAVE_QUEUE_DEPTH * 2][LOAD_ERROR_LENGTH];  // Why a save failed
+    int finished_count;
+} Autosave;
+Autosave autosave = {
+    .lock = PTHREAD_MUTEX_INITIALIZER,
+    .job_ready = PTHREAD_COND_INITIALIZER,
+    .job_done = PTHREAD_COND_INITIALIZER
+};
+
+// A dungeon floor other than the current one, which the game loop holds
+typedef struct Floor {
+    World *world;                  // Resident floors only
+    unsigned char state;           // FLOOR_ state
+    unsigned char in_save;         // Stored in the floor file beside the loaded save
+    unsigned char unfinished;      // Creatures or awards left when last in memory
+    unsigned char needs_events;    // Read from a file, which doesn't keep events
+    int exporting;                 // Export jobs that may write the resident world where it is
+} Floor;
+
+typedef struct FloorJob {
+    int kind;                      // FLOOR_JOB_ kind
+    int floor;
+    World *world;                  // Floor to write and free, to write only (export), or the floor read
+    int string_count;              // Strings interned when the job was queued
+    int unfinished;                // Progress of the floor read
+    int holds_floor;               // Counted in the floor's exporting until it has run
+    char source[MAX_FILENAME_LENGTH];  // File to read or link
+    char target[MAX_FILENAME_LENGTH];  // File to write or link
+    struct FloorJob *next;
+} FloorJob;
+
+// Floors of the dungeon and the streamer thread that moves them between
+// memory and floor files, in the order the jobs were queued
+typedef struct Dungeon {
+    Floor *floors;
+    int floor_count;
+    int current;
+    char directory[MAX_FILENAME_LENGTH];  // Session floor files, made on the first eviction
+    char save_path[MAX_FILENAME_LENGTH];  // Save the dungeon was loaded from, "" if new
+    pthread_t thread;
+    pthread_mutex_t lock;
+    pthread_cond_t job_ready;      // Signalled when a job is queued or on shutdown
+    pthread_cond_t job_done;       // Signalled when the worker finishes a job
+    FloorJob *queue_head, *queue_tail;
+    int busy;
+    int storing;                   // Store jobs queued or running; floor changes wait only for these
+    int started, stopping, exit_registered;
+    int no_directory;              // The session directory couldn't be made; floors stay in memory
+    int unfinished_change;         // Change to the unfinished floor count from floors generated again
+
+    // Telemetry
+    int resident, resident_max;    // Floors in memory, the current one included
+    int floors_stored, floors_loaded, floors_generated, failures;
+    int transitions, stalls;       // Floor changes, and those that waited for the streamer
+    double transition_total, transition_max;
+    char message[LOAD_ERROR_LENGTH + 32];  // First streamer error since the game loop last printed one
+    int messages;                  // Errors since then
+} Dungeon;
+Dungeon dungeon = {
+    .lock = PTHREAD_MUTEX_INITIALIZER,
+    .job_ready = PTHREAD_COND_INITIALIZER,
+    .job_done = PTHREAD_COND_INITIALIZER
+};
+
+// Every tracked block starts with its size and tag; a union, so the memory
+// handed out keeps malloc's alignment
+typedef union MemHeader {
+    struct {
+        size_t size;
+        int tag;
+    } block;
+    max_align_t align;
+} MemHeader;
+
+// Live and peak bytes of the tracking allocator by MEM_ tag
+typedef struct MemStats {
+    long long live_bytes[MEM_TAGS];
+    long long live_blocks[MEM_TAGS];
+    long long peak_bytes[MEM_TAGS];
+    long long total_bytes, total_peak;
+} MemStats;
+
+// The counters behind MemStats. The autosave, streamer and bot threads
+// allocate too, so they are atomics rather than one lock every allocation
+// would wait on.
+typedef struct MemCounters {
+    atomic_llong live_bytes[MEM_TAGS];
+    atomic_llong live_blocks[MEM_TAGS];
+    atomic_llong peak_bytes[MEM_TAGS];
+    atomic_llong total_bytes, total_peak;
+} MemCounters;
+MemCounters mem_stats;
+const char *mem_tag_names[MEM_TAGS] = {
+    "Rooms", "Items", "Creatures", "Events", "Names", "Worlds", "Saves", "Content", "Bot"
+};
+
 // Function Prototypes
-void initialize_game(Player *player, Room **rooms, int *room_count);
-void display_room(Room *room);
-void parse_command(Player *player, Room *rooms[], int room_count, char *command);
-void move_player(Player *player, char *direction, Room *rooms[], int room_count);
-void pickup_item(Player *player, Room *rooms[], int room_count, char *item_name);
-void attack_creature(Player *player, Room *rooms[], int room_count);
-void list_inventory(Player *player);
-void save_game(Player *player, Room *rooms[], int room_count, const char *filepath);
-int load_game(Player *player, Room **rooms, int *room_count, const char *filepath);
-void list_saved_games();  
+void initialize_game(Player *player, World *world);
+void display_room(World *world, int room);
+void parse_command(Player *player, World *world, char *command);
+void move_player(Player *player, char *direction, World *world);
+void pickup_item(Player *player, World *world, const char *item_name);
+void attack_creature(Player *player, World *world);
+int step_move(Player *player, World *world, int new_x, int new_y, int verbose);
+int step_pickup(Player *player, World *world, int item, int verbose);
+int step_attack(Player *player, World *world, uint64_t *rng, int verbose);
+void list_inventory(Player *player, World *world);
+void save_game(Player *player, World *world, const char *filepath);
+int write_save_file(SaveSnapshot *state, const char *filepath, SaveSize *size);
+int is_compressed_save_path(const char *filepath);
+void take_snapshot(SaveSnapshot *state, Player *player, World *world);
+void autosave_request(Player *player, World *world, const char *filepath, int announce);
+void autosave_tick(Player *player, World *world);
+void autosave_flush();
+void autosave_report();
+void autosave_stop();
+void display_save_stats();
+int load_game(Player *player, World *world, const char *filepath);
+int read_save_file(const char *filepath, SaveSnapshot *loaded, SaveSize *size);
+int save_floor_count(const char *filepath);
+void list_saved_games();
 void load_saved_games();
 int is_nickname_taken(const char *nickname);
 void save_game_to_list(const char *filepath);
 void delete_saved_game(const char *filepath);
-void free_resources(Room *rooms[], int room_count, Player *player);
-int is_item_in_inventory(Player *player, char *item_name);
-int has_collected_all_awards(Room *rooms[], int room_count, Player *player);
-void display_map(Room *rooms[], int room_count, Player *player);
+void free_resources(World *world, Player *player);
+int is_item_in_inventory(Player *player, World *world, int item_name);
+int has_collected_all_awards(World *world, Player *player);
+void display_map(World *world, Player *player);
 void display_help();
-void display_status(Player *player);
-int compute_total_attack(Player *player);
-int compute_total_shield(Player *player);
-Room* find_room_at_position(Room *rooms[], int room_count, int x, int y);
+void display_status(Player *player, World *world);
+int compute_total_attack(Player *player, World *world);
+int compute_total_shield(Player *player, World *world);
+int find_room_at_position(World *world, int x, int y);
+int is_discovered(World *world, int x, int y);
+void mark_discovered(World *world, int x, int y);
+int set_discovered(uint64_t bits[MAP_CHUNKS][MAP_CHUNKS], int x, int y);
+void clear_discovered(World *world);
+void invalidate_map_frame();
+void world_init(World *world);
+void world_free(World *world);
+void world_copy(World *copy, const World *world);
+World *world_clone(const World *world);
+void world_release(World *clone);
+int world_add_room(World *world, int x, int y, int description);
+int world_new_item(World *world, int name, int attack_bonus, int shield_bonus);
+void world_free_item(World *world, int item);
+int world_new_creature(World *world, int name, int health, int strength);
+void world_free_creature(World *world, int creature);
+void room_add_creature(World *world, int room, int creature);
+void room_remove_creature(World *world, int creature);
+void world_schedule(World *world, int kind, int target, int delay);
+void world_tick(World *world, uint64_t *rng);
+void world_start_events(World *world, uint64_t *rng);
+void room_add_item(World *world, int room, int item);
+void room_remove_item(World *world, int item);
+int room_find_item(World *world, int room, int name);
+int intern_string(const char *text);
+int intern_string_n(const char *text, size_t length);
+int find_string(const char *text);
+int string_count();
+void reserve_strings(int count);
+const char *string_text(int id);
+void free_string_table();
+int run_benchmarks(int room_count);
+int run_save_check(int argc, char *argv[]);
+int run_bot(int argc, char *argv[]);
+int load_content(const char *path);
+void unload_content();
+int compile_pack(const char *source, const char *output);
+const char *content_string(uint32_t offset);
+const char *content_description(int index);
+int content_roll(const int32_t range[2], uint64_t *rng);
+int is_award_name(int name);
+void dungeon_start(World *world, int floor_count);
+void dungeon_resume(World *world, const char *save_path);
+void change_floor(Player *player, World *world, int floor);
+void use_stairs(Player *player, World *world, int down);
+void dungeon_export(const char *filepath);
+int dungeon_release_save(const char *filepath);
+void dungeon_flush();
+void dungeon_stop();
+void display_floor_stats();
+void *mem_alloc(size_t size, int tag);
+void *mem_realloc(void *block, size_t size, int tag);
+void *mem_calloc(size_t count, size_t size, int tag);
+void mem_free(void *block);
+void display_memory_stats(World *world);
+long long mem_leak_report();
 
-// Function to shuffle room descriptions
-void shuffle_descriptions(const char **descriptions, int count) {
-    for (int i = count - 1; i > 0; i--) {
-        int j = rand() % (i + 1);
-        const char *temp = descriptions[i];
-        // Note: Casting away constness for shuffling
-        ((const char **)descriptions)[i] = descriptions[j];
-        ((const char **)descriptions)[j] = temp;
+int main(int argc, char *argv[]) {
+    if (argc > 1 && strcmp(argv[1], "--compile-pack") == 0) {
+        if (argc != 4) {
+            printf("Usage: --compile-pack <source> <output>\n");
+            return 1;
+        }
+        int status = compile_pack(argv[2], argv[3]);
+        return mem_leak_report() ? EXIT_FAILURE : status;
+    }
+    load_content(CONTENT_PACK_PATH);
+
+    // Headless modes; like a game, they fail if memory is left allocated
+    int status = -1;
+    if (argc > 1 && strcmp(argv[1], "--bench") == 0) {
+        status = run_benchmarks(argc > 2 ? atoi(argv[2]) : BENCH_DEFAULT_ROOMS);
+    } else if (argc > 1 && strcmp(argv[1], "--check") == 0) {
+        status = run_save_check(argc - 2, argv + 2);
+    } else if (argc > 1 && strcmp(argv[1], "--bot") == 0) {
+        status = run_bot(argc - 2, argv + 2);
+    }
+    if (status >= 0) {
+        free_string_table();
+        unload_content();
+        return mem_leak_report() ? EXIT_FAILURE : status;
     }
-}
 
-int main() {
     Player player = { .health = 100, .base_strength = 10, .inventory_count = 0, .x = 2, .y = 2 };
-    Room *rooms[MAX_ROOMS] = { NULL };
-    int room_count = 0;
+    World world;
     char command[MAX_COMMAND_LENGTH];
-    
+
+    world_init(&world);
     load_saved_games();
 
     while (1) {
@@ -117,14 +549,14 @@ int main() {
 
         char input[MAX_COMMAND_LENGTH];
         if (fgets(input, sizeof(input), stdin) == NULL) break;
-        int choice = atoi(input);  
+        int choice = atoi(input);
 
         if (choice == 1) {
             // New Game
             while (1) {
                 printf("Please enter a nickname: ");
                 if (fgets(player.nickname, sizeof(player.nickname), stdin) == NULL) break;
-                player.nickname[strcspn(player.nickname, "\n")] = '\0';  
+                player.nickname[strcspn(player.nickname, "\n")] = '\0';
 
                 if (is_nickname_taken(player.nickname)) {
                     printf("This nickname is already taken. Please choose another one.\n");
@@ -133,7 +565,8 @@ int main() {
                 }
             }
             srand(time(NULL));
-            initialize_game(&player, rooms, &room_count);
+            initialize_game(&player, &world);
+            dungeon_start(&world, content->floor_count);
 
             printf("Welcome to the Dungeon Adventure Game, %s!\n", player.nickname);
             printf("Use the 'help' command for assistance.\n");
@@ -160,7 +593,7 @@ int main() {
                     continue;
                 }
 
-                if (load_game(&player, rooms, &room_count, filepath)) {
+                if (load_game(&player, &world, filepath)) {
                     printf("Game loaded successfully!\n");
                     break;
                 } else {
@@ -174,232 +607,864 @@ int main() {
         }
     }
 
-    Room *current_room = find_room_at_position(rooms, room_count, player.x, player.y);
-    display_room(current_room);
+    display_room(&world, find_room_at_position(&world, player.x, player.y));
 
     // Game loop
     while (1) {
+        autosave_report();
         printf(">> ");
         if (fgets(command, MAX_COMMAND_LENGTH, stdin) == NULL) break;
         command[strcspn(command, "\n")] = '\0';  // Remove newline character
-        parse_command(&player, rooms, room_count, command);
+        parse_command(&player, &world, command);
+        if (game_over) break;
+        world_tick(&world, NULL);
+        autosave_tick(&player, &world);
     }
 
-    free_resources(rooms, room_count, &player);
-    return 0;
+    autosave_stop();
+    autosave_report();
+    dungeon_stop();
+    free_resources(&world, &player);
+    free_string_table();
+    unload_content();
+    return mem_leak_report() ? EXIT_FAILURE : 0;
 }
 
 // Function Implementations
-void initialize_game(Player *player, Room **rooms, int *room_count) {
-    // Structure representing cells on the map
-    typedef struct {
-        int is_room;  // 1 if a room exists, 0 if empty
-        Room *room;   // Pointer to the room
-    } Cell; 
-
-    Cell map[MAP_SIZE][MAP_SIZE] = {0}; // The map starts with all cells empty
 
-    // Shuffle the room descriptions before assignment
-    shuffle_descriptions(room_descriptions, TOTAL_DESCRIPTIONS);
+// Pick a random room description, different from the used ones while the
+// pack has enough of them
+static int pick_description(const int *used, int used_count) {
+    int count = content->description_count;
+    while (1) {
+        int description = rand() % count;
+        int repeated = 0;
+        for (int i = 0; i < used_count && count > used_count; i++) {
+            repeated |= used[i] == description;
+        }
+        if (!repeated) return description;
+    }
+}
 
-    // The player will always be at position (2,2)
-    map[2][2].is_room = 1;
+void initialize_game(Player *player, World *world) {
+    (void)player;
 
-    // Create the first room with a unique description
-    Room *initial_room = (Room *)malloc(sizeof(Room));
-    if (!initial_room) {
-        perror("Failed to allocate memory for initial room");
-        exit(EXIT_FAILURE);
-    }
-    initial_room->id = (*room_count)++;
-    initial_room->description = strdup("Starting room."); // Unique starting description
-    initial_room->item_count = 0;
-    initial_room->creature = NULL;
-    initial_room->x = 2;
-    initial_room->y = 2;
-    map[2][2].room = initial_room;
-    rooms[initial_room->id] = initial_room;
-    discovered[2][2] = 1; // Starting room is considered discovered
+    // The player will always be at position (2,2); the first room gets the
+    // pack's starting description
+    world_add_room(world, 2, 2, intern_string(content_string(content->start_description)));
+    clear_discovered(world);
+    mark_discovered(world, 2, 2); // Starting room is considered discovered
+    world->creatures_left = content->creature_count;
+    invalidate_map_frame();
 
     // Randomly place the remaining rooms
-    while (*room_count < MAX_ROOMS) {
+    int used_descriptions[MAX_ROOMS];
+    while (world->room_count < MAX_ROOMS) {
         int random_number = rand() % (MAP_SIZE * MAP_SIZE); // Random number from 0 to 24
         int row = random_number / MAP_SIZE;  // Row
         int col = random_number % MAP_SIZE;  // Column
 
         // If not the starting room and the room doesn't already exist, create a new room
-        if (!(row == 2 && col == 2)) {
-            int already_exists = 0;
-            for (int i = 0; i < *room_count; i++) {
-                if (rooms[i]->x == col && rooms[i]->y == row) {
-                    already_exists = 1;
-                    break;
-                }
-            }
+        if (!(row == 2 && col == 2) && world->cell_room[row][col] == NO_ID) {
+            int used = world->room_count - 1;
+            int description = pick_description(used_descriptions, used);
+            used_descriptions[used] = description;
+            int room = world_add_room(world, col, row, intern_string(content_description(description)));
 
-            if (!already_exists) {
-                // Create a new room
-                Room *new_room = (Room *)malloc(sizeof(Room));
-                if (!new_room) {
-                    perror("Failed to allocate memory for new room");
-                    exit(EXIT_FAILURE);
-                }
-                new_room->id = (*room_count)++;
-                new_room->description = strdup(room_descriptions[*room_count - 1 < TOTAL_DESCRIPTIONS ? *room_count - 1 : TOTAL_DESCRIPTIONS - 1]);
-                new_room->item_count = 0;
-                new_room->creature = NULL;
-                new_room->x = col;
-                new_room->y = row;
-                map[row][col].room = new_room;
-                rooms[new_room->id] = new_room;
-
-                // Add random items to the rooms
+            // Add random items to the rooms
+            if (rand() % 100 < content->item_chance) {
+                char name[32];
+                snprintf(name, sizeof(name), "%s%d", content_string(content->item_name), room);
+
+                // Assign random attack or shield bonus
+                int item;
                 if (rand() % 2 == 0) {
-                    Item *item = (Item *)malloc(sizeof(Item));
-                    if (!item) {
-                        perror("Failed to allocate memory for item");
-                        exit(EXIT_FAILURE);
-                    }
-                    item->name = (char *)malloc(32);
-                    if (!item->name) {
-                        perror("Failed to allocate memory for item name");
-                        free(item);
-                        exit(EXIT_FAILURE);
-                    }
-                    sprintf(item->name, "item%d", new_room->id);
-                    
-                    // Assign random attack or shield bonus
-                    if (rand() % 2 == 0) {
-                        item->attack_bonus = rand() % 5 + 1; // Attack bonus between 1-5
-                        item->shield_bonus = 0;
-                    } else {
-                        item->attack_bonus = 0;
-                        item->shield_bonus = rand() % 5 + 1; // Shield bonus between 1-5
-                    }
-                    new_room->items[new_room->item_count++] = item;
+                    item = world_new_item(world, intern_string(name), content_roll(content->item_attack, NULL), 0);
+                } else {
+                    item = world_new_item(world, intern_string(name), 0, content_roll(content->item_shield, NULL));
                 }
+                room_add_item(world, room, item);
             }
         }
     }
 
-    // **Place Fixed Number of Creatures**
+    // **Place the Pack's Number of Creatures**, one per room until every
+    // room but the start has one, then sharing rooms
     int created_creatures = 0;
-    while (created_creatures < FIXED_CREATURE_COUNT) {
+    while (created_creatures < content->creature_count) {
+        int crowded = created_creatures >= world->room_count - 1;
         int random_number = rand() % (MAP_SIZE * MAP_SIZE);
         int row = random_number / MAP_SIZE;
         int col = random_number % MAP_SIZE;
 
         if (!(row == 2 && col == 2)) { // Not in the starting room
-            Room *room = find_room_at_position(rooms, *room_count, col, row);
-            if (room && !room->creature) {
-                Creature *creature = (Creature *)malloc(sizeof(Creature));
-                if (!creature) {
-                    perror("Failed to allocate memory for creature");
-                    exit(EXIT_FAILURE);
-                }
-                creature->name = (char *)malloc(32);
-                if (!creature->name) {
-                    perror("Failed to allocate memory for creature name");
-                    free(creature);
-                    exit(EXIT_FAILURE);
-                }
-                sprintf(creature->name, "Creature_%d", room->id);
-                creature->health = rand() % 50 + 50;    // Health between 50-100
-                creature->strength = rand() % 10 + 5;  // Strength between 5-15
-                room->creature = creature;
+            int room = find_room_at_position(world, col, row);
+            if (room != NO_ID && (crowded || world->room_creature_count[room] == 0)) {
+                char name[32];
+                snprintf(name, sizeof(name), "%s%d", content_string(content->creature_name), room);
+                int health = content_roll(content->creature_health, NULL);
+                int strength = content_roll(content->creature_strength, NULL);
+                room_add_creature(world, room, world_new_creature(world, intern_string(name), health, strength));
                 created_creatures++;
             }
         }
     }
+    world_start_events(world, NULL);
+}
+
+// Wall-clock time in seconds
+static double now_seconds() {
+    struct timespec ts;
+    timespec_get(&ts, TIME_UTC);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+// Raise a peak counter to value unless another thread got it higher
+static void mem_raise_peak(atomic_llong *peak, long long value) {
+    long long seen = atomic_load_explicit(peak, memory_order_relaxed);
+    while (value > seen &&
+           !atomic_compare_exchange_weak_explicit(peak, &seen, value, memory_order_relaxed, memory_order_relaxed)) {
+    }
+}
+
+// Count a block in or out of a tag. The counters are only statistics and
+// order nothing else, so relaxed atomics do.
+static void mem_count(int tag, long long bytes, int blocks) {
+    long long live = atomic_fetch_add_explicit(&mem_stats.live_bytes[tag], bytes, memory_order_relaxed) + bytes;
+    atomic_fetch_add_explicit(&mem_stats.live_blocks[tag], blocks, memory_order_relaxed);
+    long long total = atomic_fetch_add_explicit(&mem_stats.total_bytes, bytes, memory_order_relaxed) + bytes;
+    if (bytes > 0) {
+        mem_raise_peak(&mem_stats.peak_bytes[tag], live);
+        mem_raise_peak(&mem_stats.total_peak, total);
+    }
+}
+
+// Tracking allocator: realloc that counts the block under tag. Returns
+// NULL on failure and leaves the old block alone, like realloc. A block
+// may move to another tag when it is resized.
+void *mem_realloc(void *block, size_t size, int tag) {
+    MemHeader *header = block ? (MemHeader *)block - 1 : NULL;
+    size_t old_size = header ? header->block.size : 0;
+    int old_tag = header ? header->block.tag : tag;
+    header = realloc(header, sizeof(MemHeader) + size);
+    if (!header) {
+        return NULL;
+    }
+    if (block) mem_count(old_tag, -(long long)old_size, -1);
+    mem_count(tag, (long long)size, 1);
+    header->block.size = size;
+    header->block.tag = tag;
+    return header + 1;
+}
+
+void *mem_alloc(size_t size, int tag) {
+    return mem_realloc(NULL, size, tag);
+}
+
+void *mem_calloc(size_t count, size_t size, int tag) {
+    if (size && count > SIZE_MAX / size) {
+        return NULL;
+    }
+    void *block = mem_alloc(count * size, tag);
+    if (block) memset(block, 0, count * size);
+    return block;
+}
+
+void mem_free(void *block) {
+    if (!block) return;
+    MemHeader *header = (MemHeader *)block - 1;
+    mem_count(header->block.tag, -(long long)header->block.size, -1);
+    free(header);
+}
+
+// Grow one of the world's parallel arrays, exiting on allocation failure
+static void *grow_array(void *array, int capacity, size_t element_size, int tag) {
+    void *grown = mem_realloc(array, (size_t)capacity * element_size, tag);
+    if (!grown) {
+        perror("Failed to allocate memory for world storage");
+        exit(EXIT_FAILURE);
+    }
+    return grown;
+}
+
+void world_init(World *world) {
+    memset(world, 0, sizeof(*world));
+    world->item_free = NO_ID;
+    world->creature_free = NO_ID;
+    world->event_free = NO_ID;
+    world->floor_count = 1;
+    world->stairs_room = NO_ID;
+    for (int y = 0; y < MAP_SIZE; y++) {
+        for (int x = 0; x < MAP_SIZE; x++) {
+            world->cell_room[y][x] = NO_ID;
+        }
+    }
+    for (int level = 0; level < WHEEL_LEVELS; level++) {
+        for (int slot = 0; slot < WHEEL_SLOTS; slot++) {
+            world->wheel[level][slot] = NO_ID;
+        }
+    }
+}
+
+void world_free(World *world) {
+    mem_free(world->room_x);
+    mem_free(world->room_y);
+    mem_free(world->room_description);
+    mem_free(world->room_item_count);
+    mem_free(world->room_first_item);
+    mem_free(world->room_last_item);
+    mem_free(world->room_creature_count);
+    mem_free(world->room_first_creature);
+    mem_free(world->room_last_creature);
+    mem_free(world->item_name);
+    mem_free(world->item_attack);
+    mem_free(world->item_shield);
+    mem_free(world->item_award);
+    mem_free(world->item_room);
+    mem_free(world->item_prev);
+    mem_free(world->item_next);
+    mem_free(world->item_next_free);
+    mem_free(world->item_index);
+    mem_free(world->item_index_hash);
+    mem_free(world->creature_name);
+    mem_free(world->creature_health);
+    mem_free(world->creature_strength);
+    mem_free(world->creature_room);
+    mem_free(world->creature_prev);
+    mem_free(world->creature_next);
+    mem_free(world->creature_next_free);
+    mem_free(world->creature_generation);
+    mem_free(world->event_kind);
+    mem_free(world->event_target);
+    mem_free(world->event_generation);
+    mem_free(world->event_due);
+    mem_free(world->event_next);
+    world_init(world);
+}
+
+static void *copy_array(const void *array, int count, size_t element_size, int tag) {
+    if (count == 0) {
+        return NULL;
+    }
+    void *copy = grow_array(NULL, count, element_size, tag);
+    memcpy(copy, array, (size_t)count * element_size);
+    return copy;
+}
+
+// Deep copy of a world; the copy's arrays are sized to the slots in use
+void world_copy(World *copy, const World *world) {
+    *copy = *world;  // Counts, free list heads and the cell index
+    copy->room_capacity = world->room_count;
+    copy->room_x = copy_array(world->room_x, world->room_count, sizeof(int), MEM_ROOMS);
+    copy->room_y = copy_array(world->room_y, world->room_count, sizeof(int), MEM_ROOMS);
+    copy->room_description = copy_array(world->room_description, world->room_count, sizeof(int), MEM_ROOMS);
+    copy->room_item_count = copy_array(world->room_item_count, world->room_count, sizeof(int), MEM_ROOMS);
+    copy->room_first_item = copy_array(world->room_first_item, world->room_count, sizeof(int), MEM_ROOMS);
+    copy->room_last_item = copy_array(world->room_last_item, world->room_count, sizeof(int), MEM_ROOMS);
+    copy->room_creature_count = copy_array(world->room_creature_count, world->room_count, sizeof(int), MEM_ROOMS);
+    copy->room_first_creature = copy_array(world->room_first_creature, world->room_count, sizeof(int), MEM_ROOMS);
+    copy->room_last_creature = copy_array(world->room_last_creature, world->room_count, sizeof(int), MEM_ROOMS);
+
+    copy->item_capacity = world->item_count;
+    copy->item_name = copy_array(world->item_name, world->item_count, sizeof(int), MEM_ITEMS);
+    copy->item_attack = copy_array(world->item_attack, world->item_count, sizeof(int), MEM_ITEMS);
+    copy->item_shield = copy_array(world->item_shield, world->item_count, sizeof(int), MEM_ITEMS);
+    copy->item_award = copy_array(world->item_award, world->item_count, 1, MEM_ITEMS);
+    copy->item_room = copy_array(world->item_room, world->item_count, sizeof(int), MEM_ITEMS);
+    copy->item_prev = copy_array(world->item_prev, world->item_count, sizeof(int), MEM_ITEMS);
+    copy->item_next = copy_array(world->item_next, world->item_count, sizeof(int), MEM_ITEMS);
+    copy->item_next_free = copy_array(world->item_next_free, world->item_count, sizeof(int), MEM_ITEMS);
+    copy->item_index = copy_array(world->item_index, world->item_index_capacity, sizeof(int), MEM_ITEMS);
+    copy->item_index_hash = copy_array(world->item_index_hash, world->item_index_capacity, sizeof(uint32_t), MEM_ITEMS);
+
+    copy->creature_capacity = world->creature_count;
+    copy->creature_name = copy_array(world->creature_name, world->creature_count, sizeof(int), MEM_CREATURES);
+    copy->creature_health = copy_array(world->creature_health, world->creature_count, sizeof(int), MEM_CREATURES);
+    copy->creature_strength = copy_array(world->creature_strength, world->creature_count, sizeof(int), MEM_CREATURES);
+    copy->creature_room = copy_array(world->creature_room, world->creature_count, sizeof(int), MEM_CREATURES);
+    copy->creature_prev = copy_array(world->creature_prev, world->creature_count, sizeof(int), MEM_CREATURES);
+    copy->creature_next = copy_array(world->creature_next, world->creature_count, sizeof(int), MEM_CREATURES);
+    copy->creature_next_free = copy_array(world->creature_next_free, world->creature_count, sizeof(int), MEM_CREATURES);
+    copy->creature_generation =
+        copy_array(world->creature_generation, world->creature_count, sizeof(int), MEM_CREATURES);
+
+    copy->event_capacity = world->event_count;
+    copy->event_kind = copy_array(world->event_kind, world->event_count, sizeof(int), MEM_EVENTS);
+    copy->event_target = copy_array(world->event_target, world->event_count, sizeof(int), MEM_EVENTS);
+    copy->event_generation = copy_array(world->event_generation, world->event_count, sizeof(int), MEM_EVENTS);
+    copy->event_due = copy_array(world->event_due, world->event_count, sizeof(int), MEM_EVENTS);
+    copy->event_next = copy_array(world->event_next, world->event_count, sizeof(int), MEM_EVENTS);
+}
+
+// Copy only what a save writes: the rooms with their item and creature
+// lists, the stats on those, exploration and the floor's place in the
+// dungeon. Free lists, back links, the name index and events stay out, so
+// this copies about half of what world_copy does; it is still proportional
+// to the floor, which the game loop pays for each save.
+static void world_copy_for_save(World *copy, const World *world) {
+    world_init(copy);
+    copy->room_count = copy->room_capacity = world->room_count;
+    copy->room_x = copy_array(world->room_x, world->room_count, sizeof(int), MEM_SAVES);
+    copy->room_y = copy_array(world->room_y, world->room_count, sizeof(int), MEM_SAVES);
+    copy->room_description = copy_array(world->room_description, world->room_count, sizeof(int), MEM_SAVES);
+    copy->room_item_count = copy_array(world->room_item_count, world->room_count, sizeof(int), MEM_SAVES);
+    copy->room_first_item = copy_array(world->room_first_item, world->room_count, sizeof(int), MEM_SAVES);
+    copy->room_creature_count = copy_array(world->room_creature_count, world->room_count, sizeof(int), MEM_SAVES);
+    copy->room_first_creature = copy_array(world->room_first_creature, world->room_count, sizeof(int), MEM_SAVES);
+
+    copy->item_count = copy->item_capacity = world->item_count;
+    copy->item_name = copy_array(world->item_name, world->item_count, sizeof(int), MEM_SAVES);
+    copy->item_attack = copy_array(world->item_attack, world->item_count, sizeof(int), MEM_SAVES);
+    copy->item_shield = copy_array(world->item_shield, world->item_count, sizeof(int), MEM_SAVES);
+    copy->item_next = copy_array(world->item_next, world->item_count, sizeof(int), MEM_SAVES);
+
+    copy->creature_count = copy->creature_capacity = world->creature_count;
+    copy->creature_name = copy_array(world->creature_name, world->creature_count, sizeof(int), MEM_SAVES);
+    copy->creature_health = copy_array(world->creature_health, world->creature_count, sizeof(int), MEM_SAVES);
+    copy->creature_strength = copy_array(world->creature_strength, world->creature_count, sizeof(int), MEM_SAVES);
+    copy->creature_next = copy_array(world->creature_next, world->creature_count, sizeof(int), MEM_SAVES);
+
+    memcpy(copy->discovered, world->discovered, sizeof(copy->discovered));
+    copy->creatures_left = world->creatures_left;
+    copy->floor = world->floor;
+    copy->floor_count = world->floor_count;
+    copy->stairs_room = world->stairs_room;
+    copy->floors_unfinished = world->floors_unfinished;
+}
+
+// Fork a session for lookahead: the clone owns its own arrays, so moves,
+// pickups and fights on it never touch the original. Exploration and the
+// creature count travel with the world; copy the Player by value alongside.
+World *world_clone(const World *world) {
+    World *clone = mem_alloc(sizeof(*clone), MEM_WORLDS);
+    if (!clone) {
+        perror("Failed to allocate memory for world clone");
+        exit(EXIT_FAILURE);
+    }
+    world_copy(clone, world);
+    return clone;
+}
+
+void world_release(World *clone) {
+    if (!clone) return;
+    world_free(clone);
+    mem_free(clone);
+}
+
+int world_add_room(World *world, int x, int y, int description) {
+    if (world->room_count == world->room_capacity) {
+        int capacity = world->room_capacity ? world->room_capacity * 2 : MAX_ROOMS;
+        world->room_x = grow_array(world->room_x, capacity, sizeof(int), MEM_ROOMS);
+        world->room_y = grow_array(world->room_y, capacity, sizeof(int), MEM_ROOMS);
+        world->room_description = grow_array(world->room_description, capacity, sizeof(int), MEM_ROOMS);
+        world->room_item_count = grow_array(world->room_item_count, capacity, sizeof(int), MEM_ROOMS);
+        world->room_first_item = grow_array(world->room_first_item, capacity, sizeof(int), MEM_ROOMS);
+        world->room_last_item = grow_array(world->room_last_item, capacity, sizeof(int), MEM_ROOMS);
+        world->room_creature_count = grow_array(world->room_creature_count, capacity, sizeof(int), MEM_ROOMS);
+        world->room_first_creature = grow_array(world->room_first_creature, capacity, sizeof(int), MEM_ROOMS);
+        world->room_last_creature = grow_array(world->room_last_creature, capacity, sizeof(int), MEM_ROOMS);
+        world->room_capacity = capacity;
+    }
+
+    int room = world->room_count++;
+    world->room_x[room] = x;
+    world->room_y[room] = y;
+    world->room_description[room] = description;
+    world->room_item_count[room] = 0;
+    world->room_first_item[room] = NO_ID;
+    world->room_last_item[room] = NO_ID;
+    world->room_creature_count[room] = 0;
+    world->room_first_creature[room] = NO_ID;
+    world->room_last_creature[room] = NO_ID;
+    if (x >= 0 && x < MAP_SIZE && y >= 0 && y < MAP_SIZE && world->cell_room[y][x] == NO_ID) {
+        world->cell_room[y][x] = room;
+    }
+    return room;
+}
+
+int world_new_item(World *world, int name, int attack_bonus, int shield_bonus) {
+    int item = world->item_free;
+    if (item != NO_ID) {
+        world->item_free = world->item_next_free[item];
+    } else {
+        if (world->item_count == world->item_capacity) {
+            int capacity = world->item_capacity ? world->item_capacity * 2 : MAX_ROOMS;
+            world->item_name = grow_array(world->item_name, capacity, sizeof(int), MEM_ITEMS);
+            world->item_attack = grow_array(world->item_attack, capacity, sizeof(int), MEM_ITEMS);
+            world->item_shield = grow_array(world->item_shield, capacity, sizeof(int), MEM_ITEMS);
+            world->item_award = grow_array(world->item_award, capacity, 1, MEM_ITEMS);
+            world->item_room = grow_array(world->item_room, capacity, sizeof(int), MEM_ITEMS);
+            world->item_prev = grow_array(world->item_prev, capacity, sizeof(int), MEM_ITEMS);
+            world->item_next = grow_array(world->item_next, capacity, sizeof(int), MEM_ITEMS);
+            world->item_next_free = grow_array(world->item_next_free, capacity, sizeof(int), MEM_ITEMS);
+            world->item_capacity = capacity;
+        }
+        item = world->item_count++;
+    }
+
+    world->item_name[item] = name;
+    world->item_attack[item] = attack_bonus;
+    world->item_shield[item] = shield_bonus;
+    world->item_award[item] = is_award_name(name);
+    world->item_room[item] = NO_ID;
+    world->item_prev[item] = NO_ID;
+    world->item_next[item] = NO_ID;
+    world->item_next_free[item] = NO_ID;
+    return item;
+}
+
+void world_free_item(World *world, int item) {
+    if (world->item_room[item] != NO_ID) {
+        room_remove_item(world, item);
+    }
+    world->item_name[item] = NO_ID;
+    world->item_award[item] = 0;
+    world->item_next_free[item] = world->item_free;
+    world->item_free = item;
+}
+
+int world_new_creature(World *world, int name, int health, int strength) {
+    int creature = world->creature_free;
+    if (creature != NO_ID) {
+        world->creature_free = world->creature_next_free[creature];
+    } else {
+        if (world->creature_count == world->creature_capacity) {
+            int capacity = world->creature_capacity ? world->creature_capacity * 2 : FIXED_CREATURE_COUNT;
+            world->creature_name = grow_array(world->creature_name, capacity, sizeof(int), MEM_CREATURES);
+            world->creature_health = grow_array(world->creature_health, capacity, sizeof(int), MEM_CREATURES);
+            world->creature_strength = grow_array(world->creature_strength, capacity, sizeof(int), MEM_CREATURES);
+            world->creature_room = grow_array(world->creature_room, capacity, sizeof(int), MEM_CREATURES);
+            world->creature_prev = grow_array(world->creature_prev, capacity, sizeof(int), MEM_CREATURES);
+            world->creature_next = grow_array(world->creature_next, capacity, sizeof(int), MEM_CREATURES);
+            world->creature_next_free = grow_array(world->creature_next_free, capacity, sizeof(int), MEM_CREATURES);
+            world->creature_generation = grow_array(world->creature_generation, capacity, sizeof(int), MEM_CREATURES);
+            world->creature_capacity = capacity;
+        }
+        creature = world->creature_count++;
+        world->creature_generation[creature] = 0;
+    }
+
+    world->creature_name[creature] = name;
+    world->creature_health[creature] = health;
+    world->creature_strength[creature] = strength;
+    world->creature_room[creature] = NO_ID;
+    world->creature_prev[creature] = NO_ID;
+    world->creature_next[creature] = NO_ID;
+    world->creature_next_free[creature] = NO_ID;
+    return creature;
+}
+
+void world_free_creature(World *world, int creature) {
+    if (world->creature_room[creature] != NO_ID) {
+        room_remove_creature(world, creature);
+    }
+    world->creature_name[creature] = NO_ID;
+    world->creature_generation[creature]++;
+    world->creature_next_free[creature] = world->creature_free;
+    world->creature_free = creature;
+}
+
+// Append a creature to a room's list
+void room_add_creature(World *world, int room, int creature) {
+    world->creature_room[creature] = room;
+    world->creature_prev[creature] = world->room_last_creature[room];
+    world->creature_next[creature] = NO_ID;
+    if (world->room_last_creature[room] != NO_ID) {
+        world->creature_next[world->room_last_creature[room]] = creature;
+    } else {
+        world->room_first_creature[room] = creature;
+    }
+    world->room_last_creature[room] = creature;
+    world->room_creature_count[room]++;
+}
+
+// Unlink a creature from its room in O(1)
+void room_remove_creature(World *world, int creature) {
+    int room = world->creature_room[creature];
+    int prev = world->creature_prev[creature];
+    int next = world->creature_next[creature];
+    if (prev != NO_ID) {
+        world->creature_next[prev] = next;
+    } else {
+        world->room_first_creature[room] = next;
+    }
+    if (next != NO_ID) {
+        world->creature_prev[next] = prev;
+    } else {
+        world->room_last_creature[room] = prev;
+    }
+    world->room_creature_count[room]--;
+    world->creature_room[creature] = NO_ID;
+    world->creature_prev[creature] = NO_ID;
+    world->creature_next[creature] = NO_ID;
+}
+
+// Hash of an item's (room, name) key in the name index
+static uint32_t item_key_hash(int room, int name) {
+    uint32_t hash = (uint32_t)room * 2654435761u ^ (uint32_t)name * 2246822519u;
+    return hash ^ (hash >> 15);
+}
+
+static void item_index_insert(World *world, int item, uint32_t hash) {
+    // Keep the load factor at or below one half
+    if ((world->item_index_count + 1) * 2 > world->item_index_capacity) {
+        int old_capacity = world->item_index_capacity;
+        int *old_index = world->item_index;
+        uint32_t *old_hash = world->item_index_hash;
+        int capacity = old_capacity ? old_capacity * 2 : ITEM_INDEX_MIN_CAPACITY;
+
+        world->item_index = grow_array(NULL, capacity, sizeof(int), MEM_ITEMS);
+        world->item_index_hash = grow_array(NULL, capacity, sizeof(uint32_t), MEM_ITEMS);
+        world->item_index_capacity = capacity;
+        world->item_index_count = 0;
+        for (int i = 0; i < capacity; i++) {
+            world->item_index[i] = NO_ID;
+        }
+        for (int i = 0; i < old_capacity; i++) {
+            if (old_index[i] != NO_ID) {
+                item_index_insert(world, old_index[i], old_hash[i]);
+            }
+        }
+        mem_free(old_index);
+        mem_free(old_hash);
+    }
+
+    int mask = world->item_index_capacity - 1;
+    int slot = hash & mask;
+    while (world->item_index[slot] != NO_ID) {
+        slot = (slot + 1) & mask;
+    }
+    world->item_index[slot] = item;
+    world->item_index_hash[slot] = hash;
+    world->item_index_count++;
+}
+
+static void item_index_remove(World *world, int item) {
+    int mask = world->item_index_capacity - 1;
+    int slot = item_key_hash(world->item_room[item], world->item_name[item]) & mask;
+    while (world->item_index[slot] != item) {
+        slot = (slot + 1) & mask;
+    }
+
+    // Backward-shift deletion: pull later entries of the probe run into the
+    // hole so lookups never need tombstones
+    int hole = slot;
+    for (int next = (hole + 1) & mask; world->item_index[next] != NO_ID; next = (next + 1) & mask) {
+        int home = world->item_index_hash[next] & mask;
+        if (((next - home) & mask) >= ((next - hole) & mask)) {
+            world->item_index[hole] = world->item_index[next];
+            world->item_index_hash[hole] = world->item_index_hash[next];
+            hole = next;
+        }
+    }
+    world->item_index[hole] = NO_ID;
+    world->item_index_count--;
+}
+
+// Append an item to a room's list and name index
+void room_add_item(World *world, int room, int item) {
+    world->item_room[item] = room;
+    world->item_prev[item] = world->room_last_item[room];
+    world->item_next[item] = NO_ID;
+    if (world->room_last_item[room] != NO_ID) {
+        world->item_next[world->room_last_item[room]] = item;
+    } else {
+        world->room_first_item[room] = item;
+    }
+    world->room_last_item[room] = item;
+    world->room_item_count[room]++;
+    item_index_insert(world, item, item_key_hash(room, world->item_name[item]));
+}
+
+// Unlink an item from the room holding it in O(1)
+void room_remove_item(World *world, int item) {
+    int room = world->item_room[item];
+    item_index_remove(world, item);
+    if (world->item_prev[item] != NO_ID) {
+        world->item_next[world->item_prev[item]] = world->item_next[item];
+    } else {
+        world->room_first_item[room] = world->item_next[item];
+    }
+    if (world->item_next[item] != NO_ID) {
+        world->item_prev[world->item_next[item]] = world->item_prev[item];
+    } else {
+        world->room_last_item[room] = world->item_prev[item];
+    }
+    world->item_prev[item] = NO_ID;
+    world->item_next[item] = NO_ID;
+    world->item_room[item] = NO_ID;
+    world->room_item_count[room]--;
+}
+
+// Find an item lying in a room by name, NO_ID if there is none
+int room_find_item(World *world, int room, int name) {
+    if (world->item_index_count == 0) {
+        return NO_ID;
+    }
+    uint32_t hash = item_key_hash(room, name);
+    int mask = world->item_index_capacity - 1;
+    for (int slot = hash & mask; world->item_index[slot] != NO_ID; slot = (slot + 1) & mask) {
+        int item = world->item_index[slot];
+        if (world->item_room[item] == room && world->item_name[item] == name) {
+            return item;
+        }
+    }
+    return NO_ID;
+}
+
+static uint32_t hash_string(const char *text, size_t length) {
+    uint32_t hash = 2166136261u;  // FNV-1a
+    for (size_t i = 0; i < length; i++) {
+        hash = (hash ^ (unsigned char)text[i]) * 16777619u;
+    }
+    return hash;
+}
+
+const char *string_text(int id) {
+    return strings.pages[id / STRING_PAGE_SIZE][id % STRING_PAGE_SIZE];
+}
+
+// Find the slot holding the given text, or the empty slot where it belongs
+static int string_slot(const char *text, size_t length, uint32_t hash) {
+    int mask = strings.slot_capacity - 1;
+    int slot = hash & mask;
+    while (strings.slots[slot] != NO_ID) {
+        const char *stored = string_text(strings.slots[slot]);
+        if (strings.slot_hash[slot] == hash && strncmp(stored, text, length) == 0 && stored[length] == '\0') {
+            break;
+        }
+        slot = (slot + 1) & mask;
+    }
+    return slot;
+}
+
+int find_string(const char *text) {
+    pthread_mutex_lock(&strings.lock);
+    int id = NO_ID;
+    if (strings.count > 0) {
+        size_t length = strlen(text);
+        id = strings.slots[string_slot(text, length, hash_string(text, length))];
+    }
+    pthread_mutex_unlock(&strings.lock);
+    return id;
+}
+
+int string_count() {
+    pthread_mutex_lock(&strings.lock);
+    int count = strings.count;
+    pthread_mutex_unlock(&strings.lock);
+    return count;
+}
+
+int intern_string(const char *text) {
+    return intern_string_n(text, strlen(text));
+}
+
+// Grow the hash set until count strings keep it at or below half full.
+// Entries move by their stored hash, so no text is re-read.
+static void grow_string_set(int count) {
+    int capacity = strings.slot_capacity ? strings.slot_capacity : STRING_PAGE_SIZE;
+    while (count * 2 > capacity) capacity *= 2;
+    if (capacity == strings.slot_capacity) {
+        return;
+    }
+    int *slots = grow_array(NULL, capacity, sizeof(int), MEM_NAMES);
+    uint32_t *slot_hash = grow_array(NULL, capacity, sizeof(uint32_t), MEM_NAMES);
+    for (int i = 0; i < capacity; i++) {
+        slots[i] = NO_ID;
+    }
+    for (int i = 0; i < strings.slot_capacity; i++) {
+        if (strings.slots[i] != NO_ID) {
+            int slot = strings.slot_hash[i] & (capacity - 1);
+            while (slots[slot] != NO_ID) slot = (slot + 1) & (capacity - 1);
+            slots[slot] = strings.slots[i];
+            slot_hash[slot] = strings.slot_hash[i];
+        }
+    }
+    mem_free(strings.slots);
+    mem_free(strings.slot_hash);
+    strings.slots = slots;
+    strings.slot_hash = slot_hash;
+    strings.slot_capacity = capacity;
+}
+
+// Make room for count more strings, e.g. a save's whole string table
+void reserve_strings(int count) {
+    pthread_mutex_lock(&strings.lock);
+    grow_string_set(strings.count + count);
+    pthread_mutex_unlock(&strings.lock);
+}
+
+// intern_string_n with strings.lock held
+static int intern_locked(const char *text, size_t length) {
+    grow_string_set(strings.count + 1);
+
+    uint32_t hash = hash_string(text, length);
+    int slot = string_slot(text, length, hash);
+    if (strings.slots[slot] != NO_ID) {
+        return strings.slots[slot];
+    }
+
+    int id = strings.count;
+    if (id == STRING_MAX_PAGES * STRING_PAGE_SIZE) {
+        printf("Error: String table is full.\n");
+        exit(EXIT_FAILURE);
+    }
+    if (id % STRING_PAGE_SIZE == 0) {
+        strings.pages[id / STRING_PAGE_SIZE] = grow_array(NULL, STRING_PAGE_SIZE, sizeof(char *), MEM_NAMES);
+    }
+
+    // Copy the text into the current storage block, starting a new one when it is full
+    if (strings.block_count == 0 || strings.block_used + length + 1 > STRING_BLOCK_SIZE) {
+        size_t block_size = length + 1 > STRING_BLOCK_SIZE ? length + 1 : STRING_BLOCK_SIZE;
+        strings.blocks = grow_array(strings.blocks, strings.block_count + 1, sizeof(char *), MEM_NAMES);
+        strings.blocks[strings.block_count] = mem_alloc(block_size, MEM_NAMES);
+        if (!strings.blocks[strings.block_count]) {
+            perror("Failed to allocate memory for string table");
+            exit(EXIT_FAILURE);
+        }
+        strings.block_count++;
+        strings.block_used = 0;
+    }
+    char *copy = strings.blocks[strings.block_count - 1] + strings.block_used;
+    memcpy(copy, text, length);
+    copy[length] = '\0';
+    strings.block_used += length + 1;
+
+    strings.pages[id / STRING_PAGE_SIZE][id % STRING_PAGE_SIZE] = copy;
+    strings.slots[slot] = id;
+    strings.slot_hash[slot] = hash;
+    strings.count++;
+    return id;
+}
+
+// Intern the first length bytes of text and return the string's id
+int intern_string_n(const char *text, size_t length) {
+    pthread_mutex_lock(&strings.lock);
+    int id = intern_locked(text, length);
+    pthread_mutex_unlock(&strings.lock);
+    return id;
+}
+
+void free_string_table() {
+    for (int i = 0; i < strings.block_count; i++) {
+        mem_free(strings.blocks[i]);
+    }
+    for (int i = 0; i * STRING_PAGE_SIZE < strings.count; i++) {
+        mem_free(strings.pages[i]);
+    }
+    mem_free(strings.blocks);
+    mem_free(strings.slots);
+    mem_free(strings.slot_hash);
+    strings = (StringTable){ .lock = PTHREAD_MUTEX_INITIALIZER };
 }
 
 // Check if a specific item exists in the player's inventory
-int is_item_in_inventory(Player *player, char *item_name) {
+int is_item_in_inventory(Player *player, World *world, int item_name) {
     for (int i = 0; i < player->inventory_count; i++) {
-        if (strcmp(player->inventory[i]->name, item_name) == 0) {
+        if (world->item_name[player->inventory[i]] == item_name) {
             return 1;  // Item found
         }
     }
     return 0;  // Item not found
 }
 
-int has_collected_all_awards(Room *rooms[], int room_count, Player *player) {
-    for (int i = 0; i < room_count; i++) {
-        Room *room = rooms[i];
-        for (int j = 0; j < room->item_count; j++) {
-            Item *item = rooms[i]->items[j];
-            if (strncmp(item->name, "award", 5) == 0 && !is_item_in_inventory(player, item->name)) {
-                return 0;  // Missing any award item
-            }
+int has_collected_all_awards(World *world, Player *player) {
+    // Walk the item pool linearly; only items still lying in a room matter
+    for (int i = 0; i < world->item_count; i++) {
+        int name = world->item_name[i];
+        if (world->item_award[i] && world->item_room[i] != NO_ID && !is_item_in_inventory(player, world, name)) {
+            return 0;  // Missing any award item
         }
     }
     return 1;  // All awards collected
 }
 
-void display_room(Room *room) {
-    if (room != NULL) {
-        printf("Room Description: %s\n", room->description);
-        if (room->item_count > 0) {
+static void print_item(World *world, int item) {
+    printf("- %s", string_text(world->item_name[item]));
+    if (world->item_attack[item] > 0) {
+        printf(" (+%d attack)", world->item_attack[item]);
+    }
+    if (world->item_shield[item] > 0) {
+        printf(" (+%d shield)", world->item_shield[item]);
+    }
+    printf("\n");
+}
+
+void display_room(World *world, int room) {
+    if (room != NO_ID) {
+        printf("Room Description: %s\n", string_text(world->room_description[room]));
+        if (world->room_item_count[room] > 0) {
             printf("Items in the room:\n");
-            for (int i = 0; i < room->item_count; i++) {
-                Item *item = room->items[i];
-                printf("- %s", item->name);
-                if (item->attack_bonus > 0) {
-                    printf(" (+%d attack)", item->attack_bonus);
-                }
-                if (item->shield_bonus > 0) {
-                    printf(" (+%d shield)", item->shield_bonus);
-                }
-                printf("\n");
+            for (int item = world->room_first_item[room]; item != NO_ID; item = world->item_next[item]) {
+                print_item(world, item);
             }
         }
-        if (room->creature != NULL) {
-            printf("Creature: %s (Health: %d)\n", room->creature->name, room->creature->health);
+        for (int creature = world->room_first_creature[room]; creature != NO_ID;
+             creature = world->creature_next[creature]) {
+            printf("Creature: %s (Health: %d)\n", string_text(world->creature_name[creature]),
+                   world->creature_health[creature]);
+        }
+        if (room == world->stairs_room) {
+            printf("Stairs lead down to floor %d.\n", world->floor + 2);
+        }
+        if (room == world->cell_room[2][2] && world->floor > 0) {
+            printf("Stairs lead up to floor %d.\n", world->floor);
         }
     } else {
         printf("You are in an empty area. There is no room here.\n");
     }
 }
 
-void parse_command(Player *player, Room *rooms[], int room_count, char *command) {
+void parse_command(Player *player, World *world, char *command) {
     char *token = strtok(command, " ");
     if (!token) return;
 
     if (strcmp(token, "move") == 0) {
         token = strtok(NULL, " ");
         if (token) {
-            move_player(player, token, rooms, room_count);
+            move_player(player, token, world);
         } else {
             printf("Usage: move <direction>\n");
         }
     } else if (strcmp(token, "look") == 0) {
-        Room *current_room = find_room_at_position(rooms, room_count, player->x, player->y);
-        display_room(current_room);
+        display_room(world, find_room_at_position(world, player->x, player->y));
     } else if (strcmp(token, "inventory") == 0) {
-        list_inventory(player);
+        list_inventory(player, world);
     } else if (strcmp(token, "pickup") == 0) {
         token = strtok(NULL, " ");
         if (token) {
-            pickup_item(player, rooms, room_count, token);
+            pickup_item(player, world, token);
         } else {
             printf("Usage: pickup <item>\n");
         }
     } else if (strcmp(token, "attack") == 0) {
-        attack_creature(player, rooms, room_count);
+        attack_creature(player, world);
+    } else if (strcmp(token, "descend") == 0 || strcmp(token, "ascend") == 0) {
+        use_stairs(player, world, strcmp(token, "descend") == 0);
     } else if (strcmp(token, "save") == 0) {
         token = strtok(NULL, " ");
         if (token) {
-            save_game(player, rooms, room_count, token);
+            save_game(player, world, token);
             save_game_to_list(token);
         } else {
             printf("Usage: save <filepath>\n");
         }
+    } else if (strcmp(token, "autosave") == 0) {
+        char filepath[MAX_FILENAME_LENGTH];
+        snprintf(filepath, sizeof(filepath), "autosave_%s.txt", player->nickname);
+        autosave_request(player, world, filepath, 1);
+    } else if (strcmp(token, "savestats") == 0) {
+        display_save_stats();
+        display_floor_stats();
+    } else if (strcmp(token, "memstats") == 0) {
+        display_memory_stats(world);
     } else if (strcmp(token, "load") == 0) {
         token = strtok(NULL, " ");
         if (token) {
-            if (load_game(player, rooms, &room_count, token)) {
+            if (load_game(player, world, token)) {
                 printf("Game successfully loaded!\n");
-                display_room(find_room_at_position(rooms, room_count, player->x, player->y));
+                display_room(world, find_room_at_position(world, player->x, player->y));
             } else {
                 printf("Failed to load file! Please enter a valid file or select 'New Game'.\n");
             }
@@ -417,19 +1482,19 @@ void parse_command(Player *player, Room *rooms[], int room_count, char *command)
         }
     } else if (strcmp(token, "exit") == 0) {
         printf("Exiting the game. Goodbye!\n");
-        exit(0);
+        game_over = 1;
     } else if (strcmp(token, "map") == 0) {
-        display_map(rooms, room_count, player);
+        display_map(world, player);
     } else if (strcmp(token, "help") == 0) {
         display_help();
     } else if (strcmp(token, "status") == 0) {
-        display_status(player);
+        display_status(player, world);
     } else {
         printf("Unknown command: %s\n", token);
     }
 }
 
-void move_player(Player *player, char *direction, Room *rooms[], int room_count) {
+void move_player(Player *player, char *direction, World *world) {
     int new_x = player->x;
     int new_y = player->y;
 
@@ -442,140 +1507,651 @@ void move_player(Player *player, char *direction, Room *rooms[], int room_count)
         return;
     }
 
+    if (step_move(player, world, new_x, new_y, 1) == STEP_WON) {
+        game_over = 1;  // End the game
+    }
+}
+
+// Rule core of a move: updates the state and returns a STEP_ result,
+// printing what happens only when verbose is set
+int step_move(Player *player, World *world, int new_x, int new_y, int verbose) {
     // Check map boundaries
     if (new_x < 0 || new_x >= MAP_SIZE || new_y < 0 || new_y >= MAP_SIZE) {
-        printf("You cannot leave the map.\n");
-        return;
+        if (verbose) printf("You cannot leave the map.\n");
+        return STEP_BLOCKED;
     }
 
-    // Update player's position
+    // Update player's position and mark the cell as explored
     player->x = new_x;
     player->y = new_y;
+    mark_discovered(world, new_x, new_y);
 
-    Room *current_room = find_room_at_position(rooms, room_count, player->x, player->y);
-    if (current_room) {
+    int current_room = find_room_at_position(world, player->x, player->y);
+    if (current_room == NO_ID) {
+        if (verbose) printf("You are in an empty area. There is no room here.\n");
+        return STEP_DONE;
+    }
+    if (verbose) {
         printf("You entered a room:\n");
-        display_room(current_room);
+        display_room(world, current_room);
+    }
 
-        if (current_room->x == 2 && current_room->y == 2) {
-            player->health = 100;  // Reset health when returning to the starting room
-        }
+    int in_start_room = world->room_x[current_room] == 2 && world->room_y[current_room] == 2;
+    if (in_start_room) {
+        player->health = 100;  // Reset health when returning to the starting room
+    }
 
-        // Check Winning Condition (Awards Only)
-        if (current_room->x == 2 && current_room->y == 2 && 
-            has_collected_all_awards(rooms, room_count, player) && creatures_left == 0) {
+    // Check Winning Condition (Awards Only), back on the top floor with every floor cleared
+    if (in_start_room && world->floor == 0 && world->floors_unfinished == 0 &&
+        has_collected_all_awards(world, player) && world->creatures_left == 0) {
+        if (verbose) {
             printf("You have collected all awards!\n");
             printf("You returned to the starting room and completed your mission successfully!\n");
             printf("Congratulations! You won the game.\n");
-            exit(0);  // End the game
         }
-    } else {
-        printf("You are in an empty area. There is no room here.\n");
+        return STEP_WON;
     }
+    return STEP_DONE;
 }
 
-Room* find_room_at_position(Room *rooms[], int room_count, int x, int y) {
-    for (int i = 0; i < room_count; i++) {
-        if (rooms[i]->x == x && rooms[i]->y == y) {
-            return rooms[i];
-        }
+int find_room_at_position(World *world, int x, int y) {
+    if (x < 0 || x >= MAP_SIZE || y < 0 || y >= MAP_SIZE) {
+        return NO_ID;
     }
-    return NULL;
+    return world->cell_room[y][x];
 }
 
-void pickup_item(Player *player, Room *rooms[], int room_count, char *item_name) {
-    Room *current_room = find_room_at_position(rooms, room_count, player->x, player->y);
-    if (current_room == NULL) {
+void pickup_item(Player *player, World *world, const char *item_name) {
+    int current_room = find_room_at_position(world, player->x, player->y);
+    if (current_room == NO_ID) {
         printf("There is no room here, you cannot pick up an item.\n");
         return;
     }
-    for (int i = 0; i < current_room->item_count; i++) {
-        if (strcmp(current_room->items[i]->name, item_name) == 0) {
-            if (player->inventory_count < MAX_INVENTORY) {
-                player->inventory[player->inventory_count++] = current_room->items[i];
-                for (int j = i; j < current_room->item_count - 1; j++) {
-                    current_room->items[j] = current_room->items[j + 1];
-                }
-                current_room->item_count--;
-                printf("%s picked up.\n", item_name);
-                return;
-            } else {
-                printf("Inventory is full!\n");
-                return;
-            }
-        }
+    int name = find_string(item_name);
+    int item = name != NO_ID ? room_find_item(world, current_room, name) : NO_ID;
+    if (item == NO_ID) {
+        printf("Item not found: %s\n", item_name);
+    } else {
+        step_pickup(player, world, item, 1);
     }
-    printf("Item not found: %s\n", item_name);
 }
 
-void attack_creature(Player *player, Room *rooms[], int room_count) {
-    Room *current_room = find_room_at_position(rooms, room_count, player->x, player->y);
-    if (!current_room || !current_room->creature) {
-        printf("There is no creature here.\n");
-        return;
+// Rule core of a pickup of an item lying in the player's room
+int step_pickup(Player *player, World *world, int item, int verbose) {
+    if (player->inventory_count >= MAX_INVENTORY) {
+        if (verbose) printf("Inventory is full!\n");
+        return STEP_BLOCKED;
+    }
+    room_remove_item(world, item);
+    player->inventory[player->inventory_count++] = item;
+    if (verbose) printf("%s picked up.\n", string_text(world->item_name[item]));
+    return STEP_DONE;
+}
+
+void attack_creature(Player *player, World *world) {
+    if (step_attack(player, world, NULL, 1) == STEP_LOST) {
+        game_over = 1;
+    }
+}
+
+// Random number in [0, n). A NULL rng draws from rand(), as the game does;
+// otherwise the caller's xorshift state is advanced, so threads running
+// rule cores on their own worlds don't share a generator.
+static int roll(uint64_t *rng, int n) {
+    if (!rng) return rand() % n;
+    uint64_t x = *rng;
+    x ^= x << 13;
+    x ^= x >> 7;
+    x ^= x << 17;
+    *rng = x;
+    return (int)(x % (uint64_t)n);
+}
+
+// Rule core of a fight with the first creature in the player's room, to
+// the death; further creatures in the room wait for the next attack
+int step_attack(Player *player, World *world, uint64_t *rng, int verbose) {
+    int current_room = find_room_at_position(world, player->x, player->y);
+    if (current_room == NO_ID || world->room_first_creature[current_room] == NO_ID) {
+        if (verbose) printf("There is no creature here.\n");
+        return STEP_BLOCKED;
     }
 
-    Creature *creature = current_room->creature;
-    printf("You started a battle with %s!\n", creature->name);
+    int creature = world->room_first_creature[current_room];
+    const char *name = string_text(world->creature_name[creature]);
+    if (verbose) printf("You started a battle with %s!\n", name);
 
-    while (creature->health > 0 && player->health > 0) {
-        int player_damage = rand() % compute_total_attack(player) + 1;
-        printf("You dealt %d damage to %s.\n", player_damage, creature->name);
-        creature->health -= player_damage;
+    while (world->creature_health[creature] > 0 && player->health > 0) {
+        int player_damage = roll(rng, compute_total_attack(player, world)) + 1;
+        if (verbose) printf("You dealt %d damage to %s.\n", player_damage, name);
+        world->creature_health[creature] -= player_damage;
 
-        if (creature->health <= 0) {
-            printf("You defeated %s!\n", creature->name);
-            free(creature->name);
-            free(creature);
-            current_room->creature = NULL;
-            creatures_left--;  // Decrease creature count
+        if (world->creature_health[creature] <= 0) {
+            if (verbose) printf("You defeated %s!\n", name);
+            world_free_creature(world, creature);
+            world->creatures_left--;  // Decrease creature count
 
             // Drop an item from the creature
-            Item *dropped_item = (Item *)malloc(sizeof(Item));
-            if (!dropped_item) {
-                perror("Failed to allocate memory for dropped item");
-                exit(EXIT_FAILURE);
+            char award_name[32];
+            snprintf(award_name, sizeof(award_name), "%s%d", content_string(content->award_name),
+                     roll(rng, content->award_variants));
+            int attack_bonus = content_roll(content->award_attack, rng);
+            int shield_bonus = content_roll(content->award_shield, rng);
+            int dropped_item = world_new_item(world, intern_string(award_name), attack_bonus, shield_bonus);
+            room_add_item(world, current_room, dropped_item);
+
+            if (verbose) printf("An item dropped: %s\n", award_name);
+            if (content->respawn_delay[1] > 0) {
+                world_schedule(world, EVENT_RESPAWN, NO_ID, content_roll(content->respawn_delay, rng));
             }
-            dropped_item->name = (char *)malloc(32);
-            if (!dropped_item->name) {
-                perror("Failed to allocate memory for dropped item name");
-                free(dropped_item);
-                exit(EXIT_FAILURE);
-            }
-            sprintf(dropped_item->name, "award%d", rand() % 100);
-            dropped_item->attack_bonus = rand() % 5 + 1;
-            dropped_item->shield_bonus = rand() % 5 + 1;
-            current_room->items[current_room->item_count++] = dropped_item;
-
-            printf("An item dropped: %s\n", dropped_item->name);
-            return;
+            return STEP_DONE;
         }
 
-        int creature_damage = rand() % creature->strength + 1 - compute_total_shield(player);
+        int creature_damage = roll(rng, world->creature_strength[creature]) + 1 - compute_total_shield(player, world);
         if (creature_damage < 0) creature_damage = 0;
 
-        printf("%s dealt %d damage to you.\n", current_room->creature->name, creature_damage);
+        if (verbose) printf("%s dealt %d damage to you.\n", name, creature_damage);
         player->health -= creature_damage;
 
         if (player->health <= 0) {
-            printf("You lost. Game over.\n");
-            exit(0);
+            if (verbose) printf("You lost. Game over.\n");
+            return STEP_LOST;
         }
     }
+    return STEP_DONE;
 }
 
-void list_inventory(Player *player) {
-    printf("Inventory:\n");
-    for (int i = 0; i < player->inventory_count; i++) {
-        Item *item = player->inventory[i];
-        printf("- %s", item->name);
-        if (item->attack_bonus > 0) {
-            printf(" (+%d attack)", item->attack_bonus);
+// Timed world events. Events live in a pool like items and creatures and
+// wait in a hierarchical timer wheel: level 0 has one slot per tick, and
+// each higher level has slots WHEEL_SLOTS times wider. Scheduling links an
+// event into one slot; a tick empties one level-0 slot and, when a wider
+// slot comes due, spreads its events over the levels below. Both are O(1)
+// per event, so pending events cost nothing until they come due.
+
+static void wheel_insert(World *world, int event) {
+    int delta = world->event_due[event] - world->tick;
+    if (delta < 0) delta = 0;
+    int level = 0;
+    while (level < WHEEL_LEVELS - 1 && delta >= 1 << (WHEEL_BITS * (level + 1))) {
+        level++;
+    }
+    // Beyond the top level's reach, wait in its farthest slot and go round again
+    int due = world->event_due[event];
+    if (level == WHEEL_LEVELS - 1 && delta >= 1 << (WHEEL_BITS * WHEEL_LEVELS)) {
+        due = world->tick + (1 << (WHEEL_BITS * WHEEL_LEVELS)) - 1;
+    }
+    int slot = (due >> (WHEEL_BITS * level)) & (WHEEL_SLOTS - 1);
+    world->event_next[event] = world->wheel[level][slot];
+    world->wheel[level][slot] = event;
+}
+
+// Schedule an event delay ticks from now (at least one). A creature event
+// remembers the creature's generation, so it goes stale once the creature
+// is freed instead of having to be found and cancelled.
+void world_schedule(World *world, int kind, int target, int delay) {
+    int event = world->event_free;
+    if (event != NO_ID) {
+        world->event_free = world->event_next[event];
+    } else {
+        if (world->event_count == world->event_capacity) {
+            int capacity = world->event_capacity ? world->event_capacity * 2 : MAX_ROOMS;
+            world->event_kind = grow_array(world->event_kind, capacity, sizeof(int), MEM_EVENTS);
+            world->event_target = grow_array(world->event_target, capacity, sizeof(int), MEM_EVENTS);
+            world->event_generation = grow_array(world->event_generation, capacity, sizeof(int), MEM_EVENTS);
+            world->event_due = grow_array(world->event_due, capacity, sizeof(int), MEM_EVENTS);
+            world->event_next = grow_array(world->event_next, capacity, sizeof(int), MEM_EVENTS);
+            world->event_capacity = capacity;
+        }
+        event = world->event_count++;
+    }
+    world->event_kind[event] = kind;
+    world->event_target[event] = target;
+    world->event_generation[event] = target != NO_ID ? world->creature_generation[target] : 0;
+    world->event_due[event] = world->tick + (delay > 0 ? delay : 1);
+    world->event_pending++;
+    wheel_insert(world, event);
+}
+
+static void world_free_event(World *world, int event) {
+    world->event_next[event] = world->event_free;
+    world->event_free = event;
+    world->event_pending--;
+}
+
+// Move a wandering creature to a random neighbouring room. Creatures stay
+// out of the starting room.
+static void wander_creature(World *world, int creature, uint64_t *rng) {
+    int room = world->creature_room[creature];
+    int x = world->room_x[room], y = world->room_y[room];
+    int choices[4], count = 0;
+    static const int dx[4] = { 0, 0, -1, 1 }, dy[4] = { -1, 1, 0, 0 };
+    for (int i = 0; i < 4; i++) {
+        int next = find_room_at_position(world, x + dx[i], y + dy[i]);
+        if (next != NO_ID && !(x + dx[i] == 2 && y + dy[i] == 2)) {
+            choices[count++] = next;
+        }
+    }
+    if (count > 0) {
+        room_remove_creature(world, creature);
+        room_add_creature(world, choices[roll(rng, count)], creature);
+    }
+}
+
+// Bring a defeated creature back in a random room other than the start
+static void respawn_creature(World *world, uint64_t *rng) {
+    int room = NO_ID;
+    for (int tries = 0; tries < 4 * MAX_ROOMS && room == NO_ID; tries++) {
+        int candidate = roll(rng, world->room_count);
+        if (world->room_x[candidate] != 2 || world->room_y[candidate] != 2) room = candidate;
+    }
+    if (room == NO_ID) return;
+    char name[32];
+    snprintf(name, sizeof(name), "%s%d", content_string(content->creature_name), room);
+    int health = content_roll(content->creature_health, rng);
+    int creature = world_new_creature(world, intern_string(name), health, content_roll(content->creature_strength, rng));
+    room_add_creature(world, room, creature);
+    world->creatures_left++;
+    world_schedule(world, EVENT_WANDER, creature, content_roll(content->wander_interval, rng));
+}
+
+static void fire_event(World *world, int event, uint64_t *rng) {
+    int kind = world->event_kind[event];
+    int creature = world->event_target[event];
+    int generation = world->event_generation[event];
+    world_free_event(world, event);
+    world->events_fired++;
+    if (kind == EVENT_RESPAWN) {
+        respawn_creature(world, rng);
+        return;
+    }
+    if (world->creature_generation[creature] != generation) {
+        return;  // Stale: the creature was defeated
+    }
+    wander_creature(world, creature, rng);
+    world_schedule(world, EVENT_WANDER, creature, content_roll(content->wander_interval, rng));
+}
+
+// Advance the world one tick, as each command does, and fire the events
+// that come due. rng as for roll().
+void world_tick(World *world, uint64_t *rng) {
+    int tick = ++world->tick;
+
+    // Spread every wider slot that starts at this tick, widest first, so
+    // its events reach level 0 before it is emptied
+    int top = 0;
+    while (top + 1 < WHEEL_LEVELS && (tick & ((1 << (WHEEL_BITS * (top + 1))) - 1)) == 0) {
+        top++;
+    }
+    for (int level = top; level > 0; level--) {
+        int slot = (tick >> (WHEEL_BITS * level)) & (WHEEL_SLOTS - 1);
+        int event = world->wheel[level][slot];
+        world->wheel[level][slot] = NO_ID;
+        while (event != NO_ID) {
+            int next = world->event_next[event];
+            wheel_insert(world, event);
+            event = next;
+        }
+    }
+
+    int slot = tick & (WHEEL_SLOTS - 1);
+    int event = world->wheel[0][slot];
+    world->wheel[0][slot] = NO_ID;
+    while (event != NO_ID) {
+        int next = world->event_next[event];
+        if (world->event_due[event] > tick) {
+            wheel_insert(world, event);  // Parked beyond the wheel's reach
+        } else {
+            fire_event(world, event, rng);
+        }
+        event = next;
+    }
+}
+
+// Schedule wandering for every creature; for new and loaded worlds, whose
+// saves don't keep events
+void world_start_events(World *world, uint64_t *rng) {
+    for (int creature = 0; creature < world->creature_count; creature++) {
+        if (world->creature_name[creature] == NO_ID) continue;
+        world_schedule(world, EVENT_WANDER, creature, content_roll(content->wander_interval, rng));
+    }
+}
+
+// Content packs. A pack source is a text file of "key: value" lines that
+// --compile-pack turns into a blob: a PackHeader, then the description
+// offsets, then NUL-terminated strings. The game maps a compiled pack and
+// reads it in place; without one it builds the same blob from the built-in
+// content.
+static const PackHeader builtin_pack = {
+    .magic = PACK_MAGIC,
+    .version = PACK_FORMAT_VERSION,
+    .creature_count = FIXED_CREATURE_COUNT,
+    .item_chance = 50,
+    .item_attack = { 1, 5 }, .item_shield = { 1, 5 },
+    .creature_health = { 50, 99 }, .creature_strength = { 5, 14 },
+    .award_attack = { 1, 5 }, .award_shield = { 1, 5 },
+    .award_variants = 100,
+    .wander_interval = { 8, 15 },
+    .respawn_delay = { 0, 0 },
+    .floor_count = 2
+};
+
+// A pack being assembled; string offsets are relative to the string area
+// until pack_finish places it after the header and description offsets
+typedef struct PackBuilder {
+    PackHeader header;
+    uint32_t *descriptions;
+    int description_count, description_capacity;
+    char *text;
+    size_t text_size, text_capacity;
+} PackBuilder;
+
+const char *content_string(uint32_t offset) {
+    return (const char *)content + offset;
+}
+
+const char *content_description(int index) {
+    const uint32_t *offsets = (const uint32_t *)((const char *)content + content->descriptions);
+    return content_string(offsets[index]);
+}
+
+// Random value in an inclusive pack range; rng as for roll()
+int content_roll(const int32_t range[2], uint64_t *rng) {
+    return range[0] + roll(rng, range[1] - range[0] + 1);
+}
+
+int is_award_name(int name) {
+    const char *prefix = content_string(content->award_name);
+    return strncmp(string_text(name), prefix, strlen(prefix)) == 0;
+}
+
+static uint32_t pack_add_string(PackBuilder *pack, const char *text) {
+    size_t length = strlen(text) + 1;
+    if (pack->text_size + length > pack->text_capacity) {
+        while (pack->text_size + length > pack->text_capacity) {
+            pack->text_capacity = pack->text_capacity ? pack->text_capacity * 2 : 4096;
+        }
+        pack->text = grow_array(pack->text, pack->text_capacity, 1, MEM_CONTENT);
+    }
+    uint32_t offset = pack->text_size;
+    memcpy(pack->text + offset, text, length);
+    pack->text_size += length;
+    return offset;
+}
+
+static void pack_add_description(PackBuilder *pack, const char *text) {
+    if (pack->description_count == pack->description_capacity) {
+        pack->description_capacity = pack->description_capacity ? pack->description_capacity * 2 : 64;
+        pack->descriptions =
+            grow_array(pack->descriptions, pack->description_capacity, sizeof(uint32_t), MEM_CONTENT);
+    }
+    pack->descriptions[pack->description_count++] = pack_add_string(pack, text);
+}
+
+// Start a pack holding the built-in balance and names, without descriptions
+static void pack_init(PackBuilder *pack) {
+    memset(pack, 0, sizeof(*pack));
+    pack->header = builtin_pack;
+    pack->header.start_description = pack_add_string(pack, "Starting room.");
+    pack->header.item_name = pack_add_string(pack, "item");
+    pack->header.creature_name = pack_add_string(pack, "Creature_");
+    pack->header.award_name = pack_add_string(pack, "award");
+}
+
+// Lay the pack out as one blob and release the builder
+static char *pack_finish(PackBuilder *pack, size_t *size) {
+    uint32_t base = sizeof(PackHeader) + (uint32_t)pack->description_count * sizeof(uint32_t);
+    *size = base + pack->text_size;
+    char *blob = grow_array(NULL, *size, 1, MEM_CONTENT);
+    PackHeader *header = (PackHeader *)blob;
+    *header = pack->header;
+    header->size = *size;
+    header->description_count = pack->description_count;
+    header->descriptions = sizeof(PackHeader);
+    header->start_description += base;
+    header->item_name += base;
+    header->creature_name += base;
+    header->award_name += base;
+    uint32_t *offsets = (uint32_t *)(blob + sizeof(PackHeader));
+    for (int i = 0; i < pack->description_count; i++) {
+        offsets[i] = pack->descriptions[i] + base;
+    }
+    memcpy(blob + base, pack->text, pack->text_size);
+    mem_free(pack->descriptions);
+    mem_free(pack->text);
+    return blob;
+}
+
+static int valid_range(const int32_t range[2], int minimum) {
+    return range[0] >= minimum && range[0] <= range[1] && range[1] < INT_MAX;
+}
+
+// A balance range whose values a save can hold
+static int valid_stat_range(const int32_t range[2], int minimum) {
+    return valid_range(range, minimum) && range[1] <= SAVE_MAX_STAT;
+}
+
+// Length of the string at offset if it ends within max_length bytes,
+// otherwise -1. Reads no further than max_length + 1 bytes.
+static long pack_string_length(const char *blob, size_t size, uint32_t offset, size_t max_length) {
+    size_t limit = size - offset < max_length + 1 ? size - offset : max_length + 1;
+    const char *end = memchr(blob + offset, '\0', limit);
+    return end ? end - (blob + offset) : -1;
+}
+
+// A description fits a save line: one line of 1 to SAVE_MAX_TEXT bytes
+static int pack_description_fits(const char *blob, size_t size, uint32_t offset) {
+    long length = pack_string_length(blob, size, offset, SAVE_MAX_TEXT);
+    return length > 0 && strcspn(blob + offset, "\r\n") == (size_t)length;
+}
+
+// A name prefix fits the name buffers and stays one word in a save
+static int pack_prefix_fits(const char *blob, size_t size, uint32_t offset) {
+    long length = pack_string_length(blob, size, offset, PACK_MAX_PREFIX);
+    return length >= 0 && strcspn(blob + offset, " \t\r\n") == (size_t)length;
+}
+
+// Check a blob's header, offsets and ranges. Every offset lies inside the
+// blob and the blob ends in a NUL, so every string is terminated; strings
+// are read only as far as their length limits. Returns an error message,
+// or NULL if it is valid.
+static const char *check_pack(const char *blob, size_t size) {
+    const PackHeader *header = (const PackHeader *)blob;
+    if (size < sizeof(PackHeader) || memcmp(header->magic, PACK_MAGIC, sizeof(header->magic)) != 0) {
+        return "not a content pack";
+    }
+    if (header->version != PACK_FORMAT_VERSION) return "unsupported pack version";
+    if (header->size != size || blob[size - 1] != '\0') return "pack is truncated";
+    if (header->description_count == 0 || header->descriptions % sizeof(uint32_t) != 0 ||
+        header->descriptions < sizeof(PackHeader) || header->descriptions > size ||
+        header->description_count > (size - header->descriptions) / sizeof(uint32_t)) {
+        return "no room descriptions or bad description table";
+    }
+    const uint32_t *offsets = (const uint32_t *)(blob + header->descriptions);
+    for (uint32_t i = 0; i < header->description_count; i++) {
+        if (offsets[i] >= size) return "description outside the pack";
+        if (!pack_description_fits(blob, size, offsets[i])) return "bad description";
+    }
+    if (header->start_description >= size || header->item_name >= size || header->creature_name >= size ||
+        header->award_name >= size || blob[header->award_name] == '\0') {
+        return "name outside the pack";
+    }
+    if (!pack_description_fits(blob, size, header->start_description)) return "bad description";
+    if (!pack_prefix_fits(blob, size, header->item_name) || !pack_prefix_fits(blob, size, header->creature_name) ||
+        !pack_prefix_fits(blob, size, header->award_name)) {
+        return "bad name prefix";
+    }
+    if (header->creature_count < 0 || header->creature_count > PACK_MAX_CREATURES) return "bad creature count";
+    if (header->item_chance < 0 || header->item_chance > 100) return "bad item chance";
+    if (!valid_stat_range(header->item_attack, 0) || !valid_stat_range(header->item_shield, 0) ||
+        !valid_stat_range(header->creature_health, 1) || !valid_stat_range(header->creature_strength, 1) ||
+        !valid_stat_range(header->award_attack, 0) || !valid_stat_range(header->award_shield, 0) ||
+        header->award_variants < 1) {
+        return "bad balance range";
+    }
+    if (!valid_range(header->wander_interval, 1) || !valid_range(header->respawn_delay, 0) ||
+        (header->respawn_delay[1] > 0 && header->respawn_delay[0] < 1)) {
+        return "bad event timing";
+    }
+    if (header->floor_count < 1 || header->floor_count > PACK_MAX_FLOORS) return "bad floor count";
+    return NULL;
+}
+
+void unload_content() {
+    if (content_mapped) {
+        munmap((void *)content, content->size);
+    } else {
+        mem_free((void *)content);
+    }
+    content = NULL;
+    content_mapped = 0;
+}
+
+// Map the compiled pack at path, or use the built-in content if there is
+// none. A pack that fails its checks is reported and ignored.
+int load_content(const char *path) {
+    if (content) unload_content();
+    int fd = open(path, O_RDONLY);
+    if (fd >= 0) {
+        struct stat info;
+        void *blob = MAP_FAILED;
+        if (fstat(fd, &info) == 0 && info.st_size > 0) {
+            blob = mmap(NULL, info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        }
+        close(fd);
+        const char *error = blob == MAP_FAILED ? strerror(errno) : check_pack(blob, info.st_size);
+        if (!error) {
+            content = blob;
+            content_mapped = 1;
+            return 1;
+        }
+        printf("Ignoring content pack %s: %s\n", path, error);
+        if (blob != MAP_FAILED) munmap(blob, info.st_size);
+    }
+
+    PackBuilder pack;
+    pack_init(&pack);
+    for (size_t i = 0; i < TOTAL_DESCRIPTIONS; i++) {
+        pack_add_description(&pack, room_descriptions[i]);
+    }
+    size_t size;
+    content = (const PackHeader *)pack_finish(&pack, &size);
+    return 0;
+}
+
+static int parse_pack_range(const char *value, int32_t range[2]) {
+    char extra;
+    return sscanf(value, "%d %d %c", &range[0], &range[1], &extra) == 2;
+}
+
+static int parse_pack_int(const char *value, int32_t *number) {
+    char extra;
+    return sscanf(value, "%d %c", number, &extra) == 1;
+}
+
+// Name prefixes become item and creature names, which saves store as words
+static int valid_name_prefix(const char *value) {
+    size_t length = strlen(value);
+    return length <= PACK_MAX_PREFIX && strcspn(value, " \t") == length;
+}
+
+// --compile-pack source output: compile a pack source into a blob. Keys
+// left out keep their built-in values; descriptions replace the built-in
+// ones. Returns 0 on success.
+int compile_pack(const char *source, const char *output) {
+    FILE *file = fopen(source, "r");
+    if (!file) {
+        printf("Error opening %s: %s\n", source, strerror(errno));
+        return 1;
+    }
+    PackBuilder pack;
+    pack_init(&pack);
+    char line[SAVE_MAX_TEXT + 64];
+    const char *error = NULL;
+    int line_number = 0;
+    while (!error && fgets(line, sizeof(line), file)) {
+        line_number++;
+        if (!strchr(line, '\n') && !feof(file)) {
+            error = "line too long";
+            continue;
         }
-        if (item->shield_bonus > 0) {
-            printf(" (+%d shield)", item->shield_bonus);
+        line[strcspn(line, "\r\n")] = '\0';
+        if (line[0] == '\0' || line[0] == '#') continue;
+        char *value = strchr(line, ':');
+        if (!value) {
+            error = "expected 'key: value'";
+            continue;
+        }
+        *value++ = '\0';
+        value += strspn(value, " \t");
+        PackHeader *header = &pack.header;
+        if (strcmp(line, "description") == 0) {
+            if (value[0] == '\0' || strlen(value) > SAVE_MAX_TEXT) error = "bad description";
+            else pack_add_description(&pack, value);
+        } else if (strcmp(line, "start") == 0) {
+            if (value[0] == '\0' || strlen(value) > SAVE_MAX_TEXT) error = "bad description";
+            else header->start_description = pack_add_string(&pack, value);
+        } else if (strcmp(line, "item_name") == 0) {
+            if (!valid_name_prefix(value)) error = "bad name prefix";
+            else header->item_name = pack_add_string(&pack, value);
+        } else if (strcmp(line, "creature_name") == 0) {
+            if (!valid_name_prefix(value)) error = "bad name prefix";
+            else header->creature_name = pack_add_string(&pack, value);
+        } else if (strcmp(line, "award_name") == 0) {
+            if (!valid_name_prefix(value) || value[0] == '\0') error = "bad name prefix";
+            else header->award_name = pack_add_string(&pack, value);
+        } else if (strcmp(line, "creature_count") == 0) {
+            if (!parse_pack_int(value, &header->creature_count)) error = "expected a number";
+        } else if (strcmp(line, "item_chance") == 0) {
+            if (!parse_pack_int(value, &header->item_chance)) error = "expected a number";
+        } else if (strcmp(line, "award_variants") == 0) {
+            if (!parse_pack_int(value, &header->award_variants)) error = "expected a number";
+        } else if (strcmp(line, "floor_count") == 0) {
+            if (!parse_pack_int(value, &header->floor_count)) error = "expected a number";
+        } else {
+            int32_t *range = strcmp(line, "item_attack") == 0 ? header->item_attack
+                           : strcmp(line, "item_shield") == 0 ? header->item_shield
+                           : strcmp(line, "creature_health") == 0 ? header->creature_health
+                           : strcmp(line, "creature_strength") == 0 ? header->creature_strength
+                           : strcmp(line, "award_attack") == 0 ? header->award_attack
+                           : strcmp(line, "award_shield") == 0 ? header->award_shield
+                           : strcmp(line, "wander_interval") == 0 ? header->wander_interval
+                           : strcmp(line, "respawn_delay") == 0 ? header->respawn_delay : NULL;
+            if (!range) error = "unknown key";
+            else if (!parse_pack_range(value, range)) error = "expected 'min max'";
         }
-        printf("\n");
+    }
+    fclose(file);
+    size_t size;
+    char *blob = pack_finish(&pack, &size);
+    if (error) {
+        printf("Error: %s at line %d of %s\n", error, line_number, source);
+        mem_free(blob);
+        return 1;
+    }
+    // Whole-pack checks, e.g. missing descriptions or inverted ranges
+    error = check_pack(blob, size);
+    if (error) {
+        printf("Error: %s in %s\n", error, source);
+        mem_free(blob);
+        return 1;
+    }
+
+    FILE *out = fopen(output, "wb");
+    int ok = out && fwrite(blob, 1, size, out) == size;
+    if (out && fclose(out) != 0) ok = 0;
+    if (ok) {
+        printf("Compiled %u descriptions into %s (%.1f KB).\n", ((PackHeader *)blob)->description_count, output,
+               size / 1024.0);
+    } else {
+        printf("Error writing %s: %s\n", output, strerror(errno));
+    }
+    mem_free(blob);
+    return !ok;
+}
+
+void list_inventory(Player *player, World *world) {
+    printf("Inventory:\n");
+    for (int i = 0; i < player->inventory_count; i++) {
+        print_item(world, player->inventory[i]);
     }
 }
 
@@ -617,7 +2193,22 @@ void save_game_to_list(const char *filepath) {
 }
 
 void delete_saved_game(const char *filepath) {
+    autosave_flush();
+    dungeon_flush();
+    if (!dungeon_release_save(filepath)) {
+        printf("Cannot delete %s: the current game still reads its floors from there.\n", filepath);
+        return;
+    }
+    // The save's other dungeon floors; for a save that can't be read, every
+    // floor a pack allows
+    int floor_count = save_floor_count(filepath);
+    if (floor_count == 0) floor_count = PACK_MAX_FLOORS;
     int file_deleted = remove(filepath);
+    for (int floor = 0; floor < floor_count; floor++) {
+        char floor_path[MAX_FILENAME_LENGTH + 32];
+        snprintf(floor_path, sizeof(floor_path), "%s.floor%d%s", filepath, floor, COMPRESSED_SAVE_EXTENSION);
+        remove(floor_path);
+    }
 
     if (file_deleted == 0) {
         printf("Successfully deleted %s from the directory.\n", filepath);
@@ -648,369 +2239,3425 @@ void delete_saved_game(const char *filepath) {
     }
 }
 
-// Save the Game
-// Save the Game
-void save_game(Player *player, Room *rooms[], int room_count, const char *filepath) {
-    FILE *file = fopen(filepath, "w");
-    if (!file) {
-        perror("Error saving game");
-        return;
+// File-local numbering of the strings a save refers to
+typedef struct SaveStrings {
+    int *file_index;  // Global string id -> index in the save, NO_ID if unused
+    int *ids;         // Index in the save -> global string id
+    int count;
+} SaveStrings;
+
+static void save_strings_add(SaveStrings *table, int id) {
+    if (table->file_index[id] == NO_ID) {
+        table->file_index[id] = table->count;
+        table->ids[table->count++] = id;
     }
+}
 
-    // Save player data
-    fprintf(file, "Nickname: %s\n", player->nickname);
-    fprintf(file, "Health: %d\nBase Strength: %d\nPosition: %d %d\nInventory Count: %d\n",
-            player->health, player->base_strength, player->x, player->y, player->inventory_count);
-    
-    // Save inventory
-    fprintf(file, "Inventory:\n");
-    for (int i = 0; i < player->inventory_count; i++) {
-        Item *item = player->inventory[i];
-        fprintf(file, "%s %d %d\n", item->name, item->attack_bonus, item->shield_bonus);
+// Compressed saves (COMPRESSED_SAVE_EXTENSION): a binary record stream cut
+// into chunks of at most SAVE_CHUNK_SIZE bytes, each compressed on its own.
+// Writer and reader hold one chunk at a time, so memory stays bounded for
+// any save size. After SAVE_MAGIC and a version byte, each chunk is
+// [raw length u32][packed length u32][codec u8][packed bytes]; a chunk with
+// raw length 0 ends the file.
+typedef struct SaveStream {
+    FILE *file;
+    unsigned char *raw;            // Uncompressed chunk
+    int raw_used;                  // Bytes buffered (writer) or available (reader)
+    int raw_pos;                   // Read position in raw
+    unsigned char *packed;         // Compressed chunk
+    int *match_table;              // LZ match finder, writer only
+    int finished;                  // Reader reached the end chunk
+    int error;                     // Sticky I/O or corruption flag
+    long long raw_bytes, packed_bytes;
+} SaveStream;
+
+static void put_u32(unsigned char *out, uint32_t value) {
+    for (int i = 0; i < 4; i++) {
+        out[i] = (unsigned char)(value >> (8 * i));
     }
+}
 
-    // Save creatures_left
-    fprintf(file, "Creatures Left: %d\n", creatures_left);
+static uint32_t get_u32(const unsigned char *in) {
+    return in[0] | (uint32_t)in[1] << 8 | (uint32_t)in[2] << 16 | (uint32_t)in[3] << 24;
+}
 
-    // Save room count
-    fprintf(file, "Room Count: %d\n", room_count);
+// Built-in LZ codec for save chunks. A chunk is a series of sequences: a
+// literal count and the literals, then, unless the chunk ends there, the
+// match length minus 4 and the match distance, all as varints. Matches
+// never reach outside their chunk.
+static int lz_put_varint(unsigned char *out, int pos, int capacity, uint32_t value) {
+    while (value >= 0x80) {
+        if (pos >= capacity) return -1;
+        out[pos++] = (unsigned char)(value | 0x80);
+        value >>= 7;
+    }
+    if (pos >= capacity) return -1;
+    out[pos++] = (unsigned char)value;
+    return pos;
+}
 
-    // Save each room's data
-    for (int i = 0; i < room_count; i++) {
-        Room *room = rooms[i];
-        fprintf(file, "Room %d:\n", room->id);
-        fprintf(file, "Description: %s\n", room->description);
-        fprintf(file, "Position: %d %d\n", room->x, room->y);
-        fprintf(file, "Item Count: %d\n", room->item_count);
-        for (int j = 0; j < room->item_count; j++) {
-            Item *item = room->items[j];
-            fprintf(file, "Item: %s %d %d\n", item->name, item->attack_bonus, item->shield_bonus);
-        }
-        if (room->creature) {
-            fprintf(file, "Creature: %s %d %d\n", room->creature->name, room->creature->health, room->creature->strength);
-        } else {
-            fprintf(file, "Creature: None\n");
-        }
+static int lz_get_varint(const unsigned char *in, int *pos, int length, uint32_t *value) {
+    *value = 0;
+    for (int shift = 0; shift < 35; shift += 7) {
+        if (*pos >= length) return 0;
+        unsigned char byte = in[(*pos)++];
+        *value |= (uint32_t)(byte & 0x7F) << shift;
+        if (!(byte & 0x80)) return 1;
     }
+    return 0;
+}
 
-    // Save discovered rooms
-    fprintf(file, "Discovered Rooms:\n");
-    for (int i = 0; i < room_count; i++) {
-        if (discovered[rooms[i]->y][rooms[i]->x]) {
-            fprintf(file, "%d %d\n", rooms[i]->x, rooms[i]->y);
+// Append a literal run to out; returns the new size, or -1 if it won't fit
+static int lz_put_literals(unsigned char *out, int pos, int capacity, const unsigned char *literals, int count) {
+    pos = lz_put_varint(out, pos, capacity, count);
+    if (pos < 0 || pos + count > capacity) return -1;
+    memcpy(out + pos, literals, count);
+    return pos + count;
+}
+
+// Greedy single-probe LZ compression; returns the packed size, or 0 if it
+// would not fit in capacity (the chunk is then stored as is)
+static int lz_compress(const unsigned char *src, int length, unsigned char *out, int capacity, int *table) {
+    memset(table, 0, sizeof(int) << SAVE_MATCH_HASH_BITS);  // Position + 1, 0 if empty
+    int pos = 0, anchor = 0, out_pos = 0;
+    while (pos + 4 <= length) {
+        uint32_t word;
+        memcpy(&word, src + pos, 4);
+        uint32_t slot = (word * 2654435761u) >> (32 - SAVE_MATCH_HASH_BITS);
+        int candidate = table[slot] - 1;
+        table[slot] = pos + 1;
+        if (candidate < 0 || memcmp(src + candidate, src + pos, 4) != 0) {
+            pos++;
+            continue;
         }
+        int match = 4;
+        while (pos + match < length && src[candidate + match] == src[pos + match]) match++;
+        out_pos = lz_put_literals(out, out_pos, capacity, src + anchor, pos - anchor);
+        if (out_pos >= 0) out_pos = lz_put_varint(out, out_pos, capacity, match - 4);
+        if (out_pos >= 0) out_pos = lz_put_varint(out, out_pos, capacity, pos - candidate);
+        if (out_pos < 0) return 0;
+        pos += match;
+        anchor = pos;
     }
-    fclose(file);
+    out_pos = lz_put_literals(out, out_pos, capacity, src + anchor, length - anchor);
+    return out_pos < 0 ? 0 : out_pos;
+}
 
-    // Save the file path to the saved games list
-    if (saved_game_count < MAX_SAVED_GAMES) {
-        strncpy(saved_games[saved_game_count], filepath, MAX_FILENAME_LENGTH - 1);
-        saved_games[saved_game_count][MAX_FILENAME_LENGTH - 1] = '\0';  // Ensure null-termination
-        saved_game_count++;
-    } else {
-        printf("Error: Maximum saved games reached.\n");
+// Expand one LZ chunk; fails on corrupt data or a size other than length
+static int lz_decompress(const unsigned char *in, int packed, unsigned char *out, int length) {
+    int in_pos = 0, out_pos = 0;
+    while (1) {
+        uint32_t literals, match, distance;
+        if (!lz_get_varint(in, &in_pos, packed, &literals) ||
+            literals > (uint32_t)(length - out_pos) || literals > (uint32_t)(packed - in_pos)) {
+            return 0;
+        }
+        memcpy(out + out_pos, in + in_pos, literals);
+        in_pos += literals;
+        out_pos += literals;
+        if (in_pos == packed) {
+            return out_pos == length;
+        }
+        if (!lz_get_varint(in, &in_pos, packed, &match) || !lz_get_varint(in, &in_pos, packed, &distance) ||
+            distance == 0 || distance > (uint32_t)out_pos ||
+            length - out_pos < 4 || match > (uint32_t)(length - out_pos - 4)) {
+            return 0;
+        }
+        for (uint32_t i = 0; i < match + 4; i++, out_pos++) {
+            out[out_pos] = out[out_pos - distance];  // Byte by byte: the match may overlap
+        }
     }
-
-    printf("Game saved to %s.\n", filepath);
 }
 
-
-int load_game(Player *player, Room **rooms, int *room_count, const char *filepath) {
-    FILE *file = fopen(filepath, "r");
-    if (!file) {
-        perror("Error loading game");
-        printf("Details: Could not open file %s. Ensure the file exists and is readable.\n", filepath);
-        return 0;
+static void save_stream_open(SaveStream *stream, FILE *file, int writing) {
+    memset(stream, 0, sizeof(*stream));
+    stream->file = file;
+    stream->raw = grow_array(NULL, SAVE_CHUNK_SIZE, 1, MEM_SAVES);
+    stream->packed = grow_array(NULL, SAVE_PACKED_CAPACITY, 1, MEM_SAVES);
+    if (writing) {
+        stream->match_table = grow_array(NULL, 1 << SAVE_MATCH_HASH_BITS, sizeof(int), MEM_SAVES);
     }
+}
 
-    memset(discovered, 0, sizeof(discovered));
+static void save_stream_close(SaveStream *stream) {
+    mem_free(stream->raw);
+    mem_free(stream->packed);
+    mem_free(stream->match_table);
+}
 
-    // Read player data
-    if (fscanf(file, "Nickname: %49s\n", player->nickname) != 1) {
-        printf("Error: Could not read nickname! File might be corrupted.\n");
-        fclose(file);
-        return 0;
+// Compress and write the buffered chunk; an empty chunk ends the stream
+static void save_flush_chunk(SaveStream *stream) {
+    const unsigned char *data = stream->raw;
+    int packed = stream->raw_used;
+    unsigned char codec = SAVE_CODEC_STORED;
+#ifdef HAVE_ZSTD
+    if (stream->raw_used > 0) {
+        size_t size = ZSTD_compress(stream->packed, SAVE_PACKED_CAPACITY, stream->raw, stream->raw_used, 3);
+        if (!ZSTD_isError(size) && size < (size_t)stream->raw_used) {
+            data = stream->packed;
+            packed = (int)size;
+            codec = SAVE_CODEC_ZSTD;
+        }
+    }
+#endif
+    if (codec == SAVE_CODEC_STORED && stream->raw_used > 0) {
+        int size = lz_compress(stream->raw, stream->raw_used, stream->packed, stream->raw_used - 1,
+                               stream->match_table);
+        if (size > 0) {
+            data = stream->packed;
+            packed = size;
+            codec = SAVE_CODEC_LZ;
+        }
     }
 
-    if (fscanf(file, "Health: %d\nBase Strength: %d\nPosition: %d %d\nInventory Count: %d\n",
-               &player->health, &player->base_strength, &player->x, &player->y, &player->inventory_count) != 5) {
-        printf("Error: Player information missing! File might be corrupted.\n");
-        fclose(file);
-        return 0;
+    unsigned char header[SAVE_CHUNK_HEADER_SIZE];
+    put_u32(header, stream->raw_used);
+    put_u32(header + 4, packed);
+    header[8] = codec;
+    if (fwrite(header, 1, sizeof(header), stream->file) != sizeof(header) ||
+        fwrite(data, 1, packed, stream->file) != (size_t)packed) {
+        stream->error = 1;
     }
+    stream->raw_bytes += stream->raw_used;
+    stream->packed_bytes += sizeof(header) + packed;
+    stream->raw_used = 0;
+}
 
-    // Load inventory
-    {
-        char line[256];
-        if (fgets(line, sizeof(line), file) == NULL || strncmp(line, "Inventory:", 10) != 0) {
-            printf("Error: Could not read Inventory header!\n");
-            fclose(file);
-            return 0;
-        }
+static void save_put_byte(SaveStream *stream, unsigned char byte) {
+    if (stream->raw_used == SAVE_CHUNK_SIZE) {
+        save_flush_chunk(stream);
+    }
+    stream->raw[stream->raw_used++] = byte;
+}
 
-        for (int i = 0; i < player->inventory_count; i++) {
-            char item_name[32];
-            int attack_bonus, shield_bonus;
+static void save_put_uint(SaveStream *stream, uint32_t value) {
+    while (value >= 0x80) {
+        save_put_byte(stream, (unsigned char)(value | 0x80));
+        value >>= 7;
+    }
+    save_put_byte(stream, (unsigned char)value);
+}
 
-            if (fscanf(file, "%31s %d %d\n", item_name, &attack_bonus, &shield_bonus) != 3) {
-                printf("Error: Could not read inventory item!\n");
-                fclose(file);
-                return 0;
-            }
+// Signed values are zigzag-encoded so small negatives stay short
+static void save_put_int(SaveStream *stream, int value) {
+    save_put_uint(stream, ((uint32_t)value << 1) ^ (value < 0 ? 0xFFFFFFFFu : 0));
+}
 
-            Item *item = (Item *)malloc(sizeof(Item));
-            if (!item) {
-                printf("Error: Memory allocation failed for item!\n");
-                fclose(file);
-                return 0;
-            }
+static void save_put_text(SaveStream *stream, const char *text) {
+    size_t length = strlen(text);
+    save_put_uint(stream, (uint32_t)length);
+    for (size_t i = 0; i < length; i++) {
+        save_put_byte(stream, (unsigned char)text[i]);
+    }
+}
 
-            item->name = strdup(item_name);
-            item->attack_bonus = attack_bonus;
-            item->shield_bonus = shield_bonus;
-            player->inventory[i] = item;
-        }
+// Strings are defined inline where first used (ref 0 followed by the text)
+// and referred to by their file index + 1 afterwards
+static void save_put_string_ref(SaveStream *stream, SaveStrings *table, int id) {
+    if (table->file_index[id] == NO_ID) {
+        save_put_uint(stream, 0);
+        save_put_text(stream, string_text(id));
+        save_strings_add(table, id);
+    } else {
+        save_put_uint(stream, table->file_index[id] + 1);
     }
+}
 
-    // Load creatures_left
-    if (fscanf(file, "Creatures Left: %d\n", &creatures_left) != 1) {
-        printf("Error: Could not read creatures_left! File might be corrupted.\n");
-        fclose(file);
+// Read and expand the next chunk; returns 0 at the end chunk or on error
+static int save_fill_chunk(SaveStream *stream) {
+    unsigned char header[SAVE_CHUNK_HEADER_SIZE];
+    if (fread(header, 1, sizeof(header), stream->file) != sizeof(header)) {
+        stream->error = 1;
         return 0;
     }
-
-    // Load room count
-    if (fscanf(file, "Room Count: %d\n", room_count) != 1) {
-        printf("Error: Could not read room count!\n");
-        fclose(file);
+    uint32_t raw = get_u32(header), packed = get_u32(header + 4);
+    if (raw == 0) {
+        stream->finished = 1;
+        return 0;
+    }
+    if (raw > SAVE_CHUNK_SIZE || packed > SAVE_PACKED_CAPACITY ||
+        fread(stream->packed, 1, packed, stream->file) != packed) {
+        stream->error = 1;
         return 0;
     }
 
-    // Load each room's data
-    for (int i = 0; i < *room_count; i++) {
-        Room *room = (Room *)malloc(sizeof(Room));
-        if (!room) {
-            printf("Error: Memory allocation failed for room!\n");
-            fclose(file);
-            return 0;
-        }
+    int ok = 0;
+    if (header[8] == SAVE_CODEC_STORED && packed == raw) {
+        memcpy(stream->raw, stream->packed, raw);
+        ok = 1;
+    } else if (header[8] == SAVE_CODEC_LZ) {
+        ok = lz_decompress(stream->packed, packed, stream->raw, raw);
+#ifdef HAVE_ZSTD
+    } else if (header[8] == SAVE_CODEC_ZSTD) {
+        ok = ZSTD_decompress(stream->raw, raw, stream->packed, packed) == raw;
+#endif
+    }
+    if (!ok) {
+        stream->error = 1;
+        return 0;
+    }
+    stream->raw_used = raw;
+    stream->raw_pos = 0;
+    stream->raw_bytes += raw;
+    stream->packed_bytes += sizeof(header) + packed;
+    return 1;
+}
 
-        // Read room header
-        if (fscanf(file, "Room %d:\n", &room->id) != 1) {
-            printf("Error: Could not read room ID!\n");
-            free(room);
-            fclose(file);
-            return 0;
-        }
+static unsigned char save_get_byte(SaveStream *stream) {
+    if (stream->raw_pos == stream->raw_used && (stream->error || !save_fill_chunk(stream))) {
+        stream->error = 1;  // Records never run past the end chunk
+        return 0;
+    }
+    return stream->raw[stream->raw_pos++];
+}
 
-        // Read description
-        char description_buffer[256];
-        if (fgets(description_buffer, sizeof(description_buffer), file) == NULL ||
-            sscanf(description_buffer, "Description: %[^\n]\n", description_buffer) != 1) {
-            printf("Error: Could not read room description!\n");
-            free(room);
-            fclose(file);
-            return 0;
-        }
-        room->description = strdup(description_buffer);
+static uint32_t save_get_uint(SaveStream *stream) {
+    uint32_t value = 0;
+    for (int shift = 0; shift < 35 && !stream->error; shift += 7) {
+        unsigned char byte = save_get_byte(stream);
+        value |= (uint32_t)(byte & 0x7F) << shift;
+        if (!(byte & 0x80)) return value;
+    }
+    stream->error = 1;
+    return 0;
+}
 
-        // Read position
-        if (fscanf(file, "Position: %d %d\n", &room->x, &room->y) != 2) {
-            printf("Error: Could not read room position!\n");
-            free(room->description);
-            free(room);
-            fclose(file);
-            return 0;
-        }
+static int save_get_int(SaveStream *stream) {
+    uint32_t value = save_get_uint(stream);
+    return (int)((value >> 1) ^ (value & 1 ? 0xFFFFFFFFu : 0));
+}
 
-        // Read item count
-        if (fscanf(file, "Item Count: %d\n", &room->item_count) != 1) {
-            printf("Error: Could not read item count!\n");
-            free(room->description);
-            free(room);
-            fclose(file);
-            return 0;
-        }
+// Read a string into text (size bytes including the terminator)
+static int save_get_text(SaveStream *stream, char *text, int size) {
+    uint32_t length = save_get_uint(stream);
+    if (length >= (uint32_t)size) {
+        stream->error = 1;
+    }
+    for (uint32_t i = 0; i < length && !stream->error; i++) {
+        text[i] = (char)save_get_byte(stream);
+    }
+    if (stream->error) return 0;
+    text[length] = '\0';
+    return 1;
+}
 
-        // Load items
-        for (int j = 0; j < room->item_count; j++) {
-            char item_label[10];
-            char item_name[32];
-            int attack_bonus, shield_bonus;
+// Strings a compressed save has defined so far, by file index
+typedef struct LoadStrings {
+    int *ids;
+    int count, capacity;
+} LoadStrings;
 
-            if (fscanf(file, "Item: %31s %d %d\n", item_name, &attack_bonus, &shield_bonus) != 3) {
-                printf("Error: Could not read room item!\n");
-                free(room->description);
-                free(room);
-                fclose(file);
-                return 0;
-            }
+static int save_get_string_ref(SaveStream *stream, LoadStrings *table) {
+    uint32_t ref = save_get_uint(stream);
+    if (stream->error) return NO_ID;
+    if (ref > 0) {
+        return ref <= (uint32_t)table->count ? table->ids[ref - 1] : NO_ID;
+    }
+    char text[SAVE_MAX_TEXT + 1];
+    if (!save_get_text(stream, text, sizeof(text))) return NO_ID;
+    if (table->count == table->capacity) {
+        table->capacity = table->capacity ? table->capacity * 2 : 64;
+        table->ids = grow_array(table->ids, table->capacity, sizeof(int), MEM_SAVES);
+    }
+    return table->ids[table->count++] = intern_string(text);
+}
 
-            Item *item = (Item *)malloc(sizeof(Item));
-            if (!item) {
-                printf("Error: Memory allocation failed for item!\n");
-                free(room->description);
-                free(room);
-                fclose(file);
-                return 0;
-            }
-
-            item->name = strdup(item_name);
-            item->attack_bonus = attack_bonus;
-            item->shield_bonus = shield_bonus;
-            room->items[j] = item;
-        }
-
-        // Read creature
-        char creature_label[20];
-        char line[256];
-        if (fgets(line, sizeof(line), file) == NULL) {
-            printf("Error: Could not read creature information!\n");
-            // Handle as no creature
-            room->creature = NULL;
-        } else {
-            if (strncmp(line, "Creature: None", 14) == 0) {
-                room->creature = NULL;
-            } else {
-                char creature_name[32];
-                int creature_health, creature_strength;
-                if (sscanf(line, "Creature: %31s %d %d\n", creature_name, &creature_health, &creature_strength) != 3) {
-                    printf("Error: Could not read creature data!\n");
-                    // Handle as no creature
-                    room->creature = NULL;
-                } else {
-                    Creature *creature = (Creature *)malloc(sizeof(Creature));
-                    if (!creature) {
-                        printf("Error: Memory allocation failed for creature!\n");
-                        // Handle as no creature
-                        room->creature = NULL;
-                    } else {
-                        creature->name = strdup(creature_name);
-                        creature->health = creature_health;
-                        creature->strength = creature_strength;
-                        room->creature = creature;
-                    }
-                }
-            }
-        }
+int is_compressed_save_path(const char *filepath) {
+    size_t length = strlen(filepath), extension = strlen(COMPRESSED_SAVE_EXTENSION);
+    return length > extension && strcmp(filepath + length - extension, COMPRESSED_SAVE_EXTENSION) == 0;
+}
 
-        // Add room to rooms array
-        rooms[room->id] = room;
+// Number every string a text save refers to, in the order records use them
+static void number_save_strings(SaveSnapshot *state, SaveStrings *table) {
+    Player *player = &state->player;
+    World *world = &state->world;
+    for (int i = 0; i < player->inventory_count; i++) {
+        save_strings_add(table, world->item_name[player->inventory[i]]);
     }
-
-    // Load discovered rooms
-    {
-        char line[256];
-        if (fgets(line, sizeof(line), file) == NULL || strncmp(line, "Discovered Rooms:", 17) != 0) {
-            printf("Warning: No discovered rooms found in save file.\n");
-        } else {
-            int x, y;
-            while (fscanf(file, "%d %d\n", &x, &y) == 2) {
-                if (y >= 0 && y < MAP_SIZE && x >= 0 && x < MAP_SIZE) {
-                    discovered[y][x] = 1;
-                }
-            }
+    for (int i = 0; i < world->room_count; i++) {
+        save_strings_add(table, world->room_description[i]);
+        for (int item = world->room_first_item[i]; item != NO_ID; item = world->item_next[item]) {
+            save_strings_add(table, world->item_name[item]);
+        }
+        for (int creature = world->room_first_creature[i]; creature != NO_ID;
+             creature = world->creature_next[creature]) {
+            save_strings_add(table, world->creature_name[creature]);
         }
     }
-
-    fclose(file);
-
-    printf("Game loaded successfully from %s.\n", filepath);
-    return 1;
 }
 
-int is_nickname_taken(const char *nickname) {
+static void write_text_save(FILE *file, SaveSnapshot *state, SaveStrings *table) {
+    Player *player = &state->player;
+    World *world = &state->world;
+    number_save_strings(state, table);
+
+    // Save player data, then the string table once; records refer to it as #<index>
+    fprintf(file, "Nickname: %s\n", player->nickname);
+    fprintf(file, "Strings: %d\n", table->count);
+    for (int i = 0; i < table->count; i++) {
+        fprintf(file, "%s\n", string_text(table->ids[i]));
+    }
+    fprintf(file, "Health: %d\nBase Strength: %d\nPosition: %d %d\nInventory Count: %d\n",
+            player->health, player->base_strength, player->x, player->y, player->inventory_count);
+
+    // Save inventory
+    fprintf(file, "Inventory:\n");
+    for (int i = 0; i < player->inventory_count; i++) {
+        int item = player->inventory[i];
+        fprintf(file, "#%d %d %d\n", table->file_index[world->item_name[item]],
+                world->item_attack[item], world->item_shield[item]);
+    }
+
+    // Save creatures_left and the floor's place in the dungeon
+    fprintf(file, "Creatures Left: %d\n", state->world.creatures_left);
+    fprintf(file, "Floor: %d of %d\n", world->floor, world->floor_count);
+    fprintf(file, "Stairs Room: %d\n", world->stairs_room);
+    fprintf(file, "Unfinished Floors: %d\n", world->floors_unfinished);
+
+    // Save room count
+    fprintf(file, "Room Count: %d\n", world->room_count);
+
+    // Save each room's data
+    for (int i = 0; i < world->room_count; i++) {
+        fprintf(file, "Room %d:\n", i);
+        fprintf(file, "Description: #%d\n", table->file_index[world->room_description[i]]);
+        fprintf(file, "Position: %d %d\n", world->room_x[i], world->room_y[i]);
+        fprintf(file, "Item Count: %d\n", world->room_item_count[i]);
+        for (int item = world->room_first_item[i]; item != NO_ID; item = world->item_next[item]) {
+            fprintf(file, "Item: #%d %d %d\n", table->file_index[world->item_name[item]],
+                    world->item_attack[item], world->item_shield[item]);
+        }
+        // One line per creature; a room without any says "None"
+        for (int creature = world->room_first_creature[i]; creature != NO_ID;
+             creature = world->creature_next[creature]) {
+            fprintf(file, "Creature: #%d %d %d\n", table->file_index[world->creature_name[creature]],
+                    world->creature_health[creature], world->creature_strength[creature]);
+        }
+        if (world->room_creature_count[i] == 0) {
+            fprintf(file, "Creature: None\n");
+        }
+    }
+
+    // Save discovered cells, walking only the set bits of each chunk
+    fprintf(file, "Discovered Rooms:\n");
+    for (int cy = 0; cy < MAP_CHUNKS; cy++) {
+        for (int cx = 0; cx < MAP_CHUNKS; cx++) {
+            uint64_t bits = state->world.discovered[cy][cx];
+            while (bits) {
+                int bit = 0;
+                while (!(bits & ((uint64_t)1 << bit))) bit++;
+                bits &= bits - 1;
+                fprintf(file, "%d %d\n", cx * MAP_CHUNK_SIZE + bit % MAP_CHUNK_SIZE,
+                        cy * MAP_CHUNK_SIZE + bit / MAP_CHUNK_SIZE);
+            }
+        }
+    }
+}
+
+// Same records as the text save, without labels, streamed through the
+// chunk compressor
+static void write_compressed_save(FILE *file, SaveSnapshot *state, SaveStrings *table, SaveStream *stream) {
+    Player *player = &state->player;
+    World *world = &state->world;
+    unsigned char version = SAVE_FORMAT_VERSION;
+    if (fwrite(SAVE_MAGIC, 1, SAVE_MAGIC_SIZE, file) != SAVE_MAGIC_SIZE || fwrite(&version, 1, 1, file) != 1) {
+        stream->error = 1;
+    }
+
+    save_put_text(stream, player->nickname);
+    save_put_int(stream, player->health);
+    save_put_int(stream, player->base_strength);
+    save_put_int(stream, player->x);
+    save_put_int(stream, player->y);
+    save_put_uint(stream, player->inventory_count);
+    for (int i = 0; i < player->inventory_count; i++) {
+        int item = player->inventory[i];
+        save_put_string_ref(stream, table, world->item_name[item]);
+        save_put_int(stream, world->item_attack[item]);
+        save_put_int(stream, world->item_shield[item]);
+    }
+    save_put_int(stream, state->world.creatures_left);
+    save_put_int(stream, world->floor);
+    save_put_int(stream, world->floor_count);
+    save_put_int(stream, world->stairs_room);
+    save_put_int(stream, world->floors_unfinished);
+
+    save_put_uint(stream, world->room_count);
+    for (int i = 0; i < world->room_count; i++) {
+        save_put_byte(stream, SAVE_RECORD_ROOM);
+        save_put_int(stream, world->room_x[i]);
+        save_put_int(stream, world->room_y[i]);
+        save_put_string_ref(stream, table, world->room_description[i]);
+        save_put_uint(stream, world->room_item_count[i]);
+        for (int item = world->room_first_item[i]; item != NO_ID; item = world->item_next[item]) {
+            save_put_string_ref(stream, table, world->item_name[item]);
+            save_put_int(stream, world->item_attack[item]);
+            save_put_int(stream, world->item_shield[item]);
+        }
+        save_put_uint(stream, world->room_creature_count[i]);
+        for (int creature = world->room_first_creature[i]; creature != NO_ID;
+             creature = world->creature_next[creature]) {
+            save_put_string_ref(stream, table, world->creature_name[creature]);
+            save_put_int(stream, world->creature_health[creature]);
+            save_put_int(stream, world->creature_strength[creature]);
+        }
+    }
+
+    int cells = 0;
+    for (int cy = 0; cy < MAP_CHUNKS; cy++) {
+        for (int cx = 0; cx < MAP_CHUNKS; cx++) {
+            for (uint64_t bits = state->world.discovered[cy][cx]; bits; bits &= bits - 1) cells++;
+        }
+    }
+    save_put_byte(stream, SAVE_RECORD_DISCOVERED);
+    save_put_uint(stream, cells);
+    for (int cy = 0; cy < MAP_CHUNKS; cy++) {
+        for (int cx = 0; cx < MAP_CHUNKS; cx++) {
+            for (int bit = 0; bit < MAP_CHUNK_SIZE * MAP_CHUNK_SIZE; bit++) {
+                if (state->world.discovered[cy][cx] & ((uint64_t)1 << bit)) {
+                    save_put_uint(stream, cx * MAP_CHUNK_SIZE + bit % MAP_CHUNK_SIZE);
+                    save_put_uint(stream, cy * MAP_CHUNK_SIZE + bit / MAP_CHUNK_SIZE);
+                }
+            }
+        }
+    }
+    save_put_byte(stream, SAVE_RECORD_END);
+
+    if (stream->raw_used > 0) {
+        save_flush_chunk(stream);
+    }
+    save_flush_chunk(stream);  // End chunk
+}
+
+// Load and save errors go to the console, or into the calling thread's
+// buffer while the save checker or the floor streamer collects them (only
+// the first is kept)
+static _Thread_local char *load_error_buffer;
+
+static void load_error(const char *format, ...) {
+    va_list args;
+    va_start(args, format);
+    if (!load_error_buffer) {
+        vprintf(format, args);
+    } else if (load_error_buffer[0] == '\0') {
+        vsnprintf(load_error_buffer, LOAD_ERROR_LENGTH, format, args);
+    }
+    va_end(args);
+}
+
+// Write a save file from a snapshot; paths ending in
+// COMPRESSED_SAVE_EXTENSION get a compressed save, others a text save. It
+// only reads the snapshot and strings interned before the snapshot was
+// taken, so it is safe to run on the autosave thread. The file is written
+// beside the target and renamed into place, so a reader never sees a
+// half-written save. size, if given, receives the save's sizes.
+int write_save_file(SaveSnapshot *state, const char *filepath, SaveSize *size) {
+    int compressed = is_compressed_save_path(filepath);
+    char temp_path[MAX_FILENAME_LENGTH + 8];
+    snprintf(temp_path, sizeof(temp_path), "%s.tmp", filepath);
+    FILE *file = fopen(temp_path, compressed ? "wb" : "w");
+    if (!file) {
+        load_error("Error saving game: %s\n", strerror(errno));
+        return 0;
+    }
+
+    SaveStrings table = { .count = 0 };
+    table.file_index = grow_array(NULL, state->string_count + 1, sizeof(int), MEM_SAVES);
+    table.ids = grow_array(NULL, state->string_count + 1, sizeof(int), MEM_SAVES);
+    for (int i = 0; i < state->string_count; i++) {
+        table.file_index[i] = NO_ID;
+    }
+    SaveSize written_size = { .compressed = compressed };
+    int written;
+    if (compressed) {
+        SaveStream stream;
+        save_stream_open(&stream, file, 1);
+        write_compressed_save(file, state, &table, &stream);
+        written = !stream.error;
+        written_size.raw_bytes = stream.raw_bytes;
+        written_size.file_bytes = SAVE_MAGIC_SIZE + 1 + stream.packed_bytes;
+        save_stream_close(&stream);
+    } else {
+        write_text_save(file, state, &table);
+        written_size.raw_bytes = written_size.file_bytes = ftell(file);
+        written = 1;
+    }
+    mem_free(table.file_index);
+    mem_free(table.ids);
+    written = written && !ferror(file);
+    if (fclose(file) != 0 || !written) {
+        load_error("Error saving game: %s\n", strerror(errno));
+        remove(temp_path);
+        return 0;
+    }
+
+    // Replace the previous save; rename cannot overwrite on every platform
+    if (rename(temp_path, filepath) != 0) {
+        remove(filepath);
+        if (rename(temp_path, filepath) != 0) {
+            load_error("Error saving game: %s\n", strerror(errno));
+            remove(temp_path);
+            return 0;
+        }
+    }
+    if (size) {
+        *size = written_size;
+    }
+    return 1;
+}
+
+// Capture everything a save records. The parts of the world a save writes
+// are copied so the game can keep changing it while the snapshot is
+// written.
+void take_snapshot(SaveSnapshot *state, Player *player, World *world) {
+    state->player = *player;
+    world_copy_for_save(&state->world, world);
+    state->string_count = string_count();
+}
+
+// Save the Game: the snapshot is written on the autosave thread, so the
+// game loop only pays for the copy
+void save_game(Player *player, World *world, const char *filepath) {
+    autosave_request(player, world, filepath, 1);
+
+    // Save the file path to the saved games list
+    if (saved_game_count < MAX_SAVED_GAMES) {
+        strncpy(saved_games[saved_game_count], filepath, MAX_FILENAME_LENGTH - 1);
+        saved_games[saved_game_count][MAX_FILENAME_LENGTH - 1] = '\0';  // Ensure null-termination
+        saved_game_count++;
+    } else {
+        printf("Error: Maximum saved games reached.\n");
+    }
+
+    printf("Saving game to %s in the background.\n", filepath);
+}
+
+
+static void *autosave_worker(void *arg) {
+    (void)arg;
+    char error[LOAD_ERROR_LENGTH];
+    load_error_buffer = error;
+    pthread_mutex_lock(&autosave.lock);
+    while (1) {
+        while (autosave.queue_count == 0 && !autosave.stopping) {
+            pthread_cond_wait(&autosave.job_ready, &autosave.lock);
+        }
+        if (autosave.queue_count == 0) {
+            break;  // Stopping and the queue is drained
+        }
+        SaveJob *job = autosave.queue[autosave.queue_head];
+        autosave.queue_head = (autosave.queue_head + 1) % AUTOSAVE_QUEUE_DEPTH;
+        autosave.queue_count--;
+        autosave.busy = 1;
+        pthread_mutex_unlock(&autosave.lock);
+
+        double start = now_seconds();
+        SaveSize size;
+        error[0] = '\0';
+        int ok = write_save_file(&job->state, job->filepath, &size);
+        double seconds = now_seconds() - start;
+        world_free(&job->state.world);
+
+        pthread_mutex_lock(&autosave.lock);
+        if (ok) {
+            autosave.saves_written++;
+            autosave.write_total += seconds;
+            if (seconds > autosave.write_max) autosave.write_max = seconds;
+            if (size.compressed) {
+                autosave.compressed_saves++;
+                autosave.compressed_raw += size.raw_bytes;
+                autosave.compressed_file += size.file_bytes;
+                autosave.compressed_seconds += seconds;
+            }
+        } else {
+            autosave.saves_failed++;
+        }
+        if ((job->announce || !ok) && autosave.finished_count < AUTOSAVE_QUEUE_DEPTH * 2) {
+            strcpy(autosave.finished[autosave.finished_count], job->filepath);
+            strcpy(autosave.finished_error[autosave.finished_count], error);
+            autosave.finished_ok[autosave.finished_count++] = ok;
+        }
+        autosave.busy = 0;
+        pthread_cond_broadcast(&autosave.job_done);
+        mem_free(job);
+    }
+    pthread_mutex_unlock(&autosave.lock);
+    load_error_buffer = NULL;
+    return NULL;
+}
+
+// Drain pending saves and stop the worker; registered with atexit so saves
+// queued before an exit still reach the disk
+void autosave_stop() {
+    if (!autosave.started) {
+        return;
+    }
+    pthread_mutex_lock(&autosave.lock);
+    autosave.stopping = 1;
+    pthread_cond_signal(&autosave.job_ready);
+    pthread_mutex_unlock(&autosave.lock);
+    pthread_join(autosave.thread, NULL);
+    autosave.started = 0;
+    autosave.stopping = 0;
+}
+
+// Snapshot the game and queue it for the worker thread
+void autosave_request(Player *player, World *world, const char *filepath, int announce) {
+    if (!autosave.started) {
+        if (pthread_create(&autosave.thread, NULL, autosave_worker, NULL) != 0) {
+            perror("Failed to start autosave thread");
+            exit(EXIT_FAILURE);
+        }
+        autosave.started = 1;
+        atexit(autosave_stop);
+    }
+
+    autosave.commands_since_save = 0;
+    double start = now_seconds();
+    SaveJob *job = mem_alloc(sizeof(SaveJob), MEM_SAVES);
+    if (!job) {
+        perror("Failed to allocate memory for save snapshot");
+        exit(EXIT_FAILURE);
+    }
+    take_snapshot(&job->state, player, world);
+    dungeon_export(filepath);  // The dungeon's other floors go beside the save
+    strncpy(job->filepath, filepath, MAX_FILENAME_LENGTH - 1);
+    job->filepath[MAX_FILENAME_LENGTH - 1] = '\0';
+    job->announce = announce;
+    double pause = now_seconds() - start;
+
+    pthread_mutex_lock(&autosave.lock);
+    if (autosave.queue_count == AUTOSAVE_QUEUE_DEPTH) {
+        // Back-pressure: wait for the worker instead of piling up snapshots
+        double stall_start = now_seconds();
+        while (autosave.queue_count == AUTOSAVE_QUEUE_DEPTH) {
+            pthread_cond_wait(&autosave.job_done, &autosave.lock);
+        }
+        autosave.stalls++;
+        autosave.stall_total += now_seconds() - stall_start;
+    }
+    autosave.queue[(autosave.queue_head + autosave.queue_count) % AUTOSAVE_QUEUE_DEPTH] = job;
+    autosave.queue_count++;
+    autosave.snapshots++;
+    autosave.pause_total += pause;
+    if (pause > autosave.pause_max) autosave.pause_max = pause;
+    pthread_cond_signal(&autosave.job_ready);
+    pthread_mutex_unlock(&autosave.lock);
+}
+
+// Periodic autosave, called once per game command
+void autosave_tick(Player *player, World *world) {
+    if (++autosave.commands_since_save < AUTOSAVE_INTERVAL) {
+        return;
+    }
+    char filepath[MAX_FILENAME_LENGTH];
+    snprintf(filepath, sizeof(filepath), "autosave_%s.txt", player->nickname);
+    autosave_request(player, world, filepath, 0);
+}
+
+// Wait until every queued save is on disk
+void autosave_flush() {
+    pthread_mutex_lock(&autosave.lock);
+    while (autosave.queue_count > 0 || autosave.busy) {
+        pthread_cond_wait(&autosave.job_done, &autosave.lock);
+    }
+    pthread_mutex_unlock(&autosave.lock);
+}
+
+// Tell the player about saves the worker has finished since the last call
+void autosave_report() {
+    pthread_mutex_lock(&autosave.lock);
+    for (int i = 0; i < autosave.finished_count; i++) {
+        if (autosave.finished_ok[i]) {
+            printf("Game saved to %s.\n", autosave.finished[i]);
+        } else {
+            printf("Error: Could not save game to %s.\n%s", autosave.finished[i], autosave.finished_error[i]);
+        }
+    }
+    autosave.finished_count = 0;
+    pthread_mutex_unlock(&autosave.lock);
+}
+
+void display_save_stats() {
+    pthread_mutex_lock(&autosave.lock);
+    int saves = autosave.saves_written;
+    printf("Save Statistics:\n");
+    printf("Saves written: %d (failed: %d, pending: %d)\n", saves, autosave.saves_failed,
+           autosave.queue_count + autosave.busy);
+    if (autosave.snapshots > 0) {
+        printf("Snapshot pause: avg %.3f ms, max %.3f ms\n",
+               autosave.pause_total * 1e3 / autosave.snapshots, autosave.pause_max * 1e3);
+    }
+    if (saves > 0) {
+        printf("Full save time: avg %.3f ms, max %.3f ms\n",
+               autosave.write_total * 1e3 / saves, autosave.write_max * 1e3);
+    }
+    printf("Back-pressure stalls: %d (%.3f ms total)\n", autosave.stalls, autosave.stall_total * 1e3);
+    if (autosave.compressed_saves > 0) {
+        printf("Compressed saves: %d, %.1f KB -> %.1f KB (%.2fx), %.1f MB/s\n", autosave.compressed_saves,
+               autosave.compressed_raw / 1024.0, autosave.compressed_file / 1024.0,
+               (double)autosave.compressed_raw / autosave.compressed_file,
+               autosave.compressed_seconds > 0 ? autosave.compressed_raw / autosave.compressed_seconds / 1e6 : 0.0);
+    }
+    pthread_mutex_unlock(&autosave.lock);
+}
+
+// Cursor of the text save parser over a save read fully into memory. Fields
+// are parsed in place, so loading allocates nothing per record.
+typedef struct TextCursor {
+    const char *pos, *end;
+    const char *line_start;
+    int line;                      // 1-based, for error messages
+    int *file_strings;             // Save string index -> string id
+    int file_string_count;
+    int has_string_table;          // Older saves have none and hold literal names
+} TextCursor;
+
+static int text_fail(TextCursor *cursor, const char *what) {
+    load_error("Error: %s at line %d, column %d! File might be corrupted.\n", what, cursor->line,
+               (int)(cursor->pos - cursor->line_start) + 1);
+    return 0;
+}
+
+static void text_skip_blanks(TextCursor *cursor) {
+    while (cursor->pos < cursor->end && (*cursor->pos == ' ' || *cursor->pos == '\t')) cursor->pos++;
+}
+
+// Consume literal if the input continues with it
+static int text_expect(TextCursor *cursor, const char *literal) {
+    size_t length = strlen(literal);
+    if ((size_t)(cursor->end - cursor->pos) < length || memcmp(cursor->pos, literal, length) != 0) {
+        return 0;
+    }
+    cursor->pos += length;
+    return 1;
+}
+
+// Finish a line: trailing blanks, an optional '\r', then '\n' or the end
+static int text_end_line(TextCursor *cursor) {
+    text_skip_blanks(cursor);
+    if (cursor->pos < cursor->end && *cursor->pos == '\r') cursor->pos++;
+    if (cursor->pos == cursor->end) return 1;
+    if (*cursor->pos != '\n') return 0;
+    cursor->pos++;
+    cursor->line++;
+    cursor->line_start = cursor->pos;
+    return 1;
+}
+
+static int text_int(TextCursor *cursor, int *value) {
+    text_skip_blanks(cursor);
+    const char *p = cursor->pos;
+    int negative = p < cursor->end && *p == '-';
+    if (p < cursor->end && (*p == '-' || *p == '+')) p++;
+    const char *digits = p;
+    long long number = 0;
+    while (p < cursor->end && *p >= '0' && *p <= '9') {
+        number = number * 10 + (*p++ - '0');
+        if (number > (long long)INT_MAX + negative) return 0;
+    }
+    if (p == digits) return 0;
+    *value = (int)(negative ? -number : number);
+    cursor->pos = p;
+    return 1;
+}
+
+// A number in [minimum, maximum]. One out of range leaves the cursor at its
+// start, so text_fail points at it.
+static int text_int_in(TextCursor *cursor, int *value, int minimum, int maximum) {
+    text_skip_blanks(cursor);
+    const char *start = cursor->pos;
+    if (!text_int(cursor, value)) return 0;
+    if (*value < minimum || *value > maximum) {
+        cursor->pos = start;
+        return 0;
+    }
+    return 1;
+}
+
+// A run of non-blank characters, such as an item name
+static int text_word(TextCursor *cursor, const char **start, size_t *length) {
+    text_skip_blanks(cursor);
+    const char *p = cursor->pos;
+    while (p < cursor->end && *p != ' ' && *p != '\t' && *p != '\r' && *p != '\n') p++;
+    if (p == cursor->pos) return 0;
+    *start = cursor->pos;
+    *length = p - cursor->pos;
+    cursor->pos = p;
+    return 1;
+}
+
+// The rest of the line without its line ending, such as a description
+static void text_rest_of_line(TextCursor *cursor, const char **start, size_t *length) {
+    const char *p = memchr(cursor->pos, '\n', cursor->end - cursor->pos);
+    if (!p) p = cursor->end;
+    *start = cursor->pos;
+    *length = p - cursor->pos;
+    if (*length > 0 && (*start)[*length - 1] == '\r') (*length)--;
+    cursor->pos = *start + *length;
+}
+
+// Map a name or description field to a string id. "#<n>" refers to the
+// save's string table; anything else is literal text from an older save.
+static int text_string_ref(TextCursor *cursor, const char *start, size_t length) {
+    if (!cursor->has_string_table || length < 2 || start[0] != '#') {
+        return intern_string_n(start, length);
+    }
+    int index = 0;
+    for (size_t i = 1; i < length; i++) {
+        if (start[i] < '0' || start[i] > '9' || index >= cursor->file_string_count) return NO_ID;
+        index = index * 10 + (start[i] - '0');
+    }
+    return index < cursor->file_string_count ? cursor->file_strings[index] : NO_ID;
+}
+
+// Read "<name> <attack> <shield>" as an item of loaded_world
+static int text_item(TextCursor *cursor, World *loaded_world, int *item) {
+    const char *start;
+    size_t length;
+    int attack_bonus, shield_bonus;
+    if (!text_word(cursor, &start, &length) || !text_int_in(cursor, &attack_bonus, 0, SAVE_MAX_STAT) ||
+        !text_int_in(cursor, &shield_bonus, 0, SAVE_MAX_STAT)) {
+        return text_fail(cursor, "Invalid item");
+    }
+    int name = text_string_ref(cursor, start, length);
+    if (name == NO_ID) {
+        cursor->pos = start;
+        return text_fail(cursor, "Invalid item name");
+    }
+    if (!text_end_line(cursor)) return text_fail(cursor, "Unexpected text after item");
+    *item = world_new_item(loaded_world, name, attack_bonus, shield_bonus);
+    return 1;
+}
+
+static int parse_text_save(TextCursor *cursor, Player *loaded, World *loaded_world) {
+    const char *start;
+    size_t length;
+    int count;
+
+    // Player data
+    if (!text_expect(cursor, "Nickname:") || !text_word(cursor, &start, &length) ||
+        length >= sizeof(loaded->nickname) || !text_end_line(cursor)) {
+        return text_fail(cursor, "Could not read nickname");
+    }
+    memcpy(loaded->nickname, start, length);
+    loaded->nickname[length] = '\0';
+
+    // String table; saves written before it existed have none
+    if (text_expect(cursor, "Strings:")) {
+        if (!text_int(cursor, &count) || count < 0 || count > cursor->end - cursor->pos ||
+            !text_end_line(cursor)) {
+            return text_fail(cursor, "Invalid string table");
+        }
+        cursor->has_string_table = 1;
+        cursor->file_strings = grow_array(NULL, count + 1, sizeof(int), MEM_SAVES);
+        reserve_strings(count);
+        for (int i = 0; i < count; i++) {
+            if (cursor->pos == cursor->end) return text_fail(cursor, "Could not read string table");
+            text_rest_of_line(cursor, &start, &length);
+            cursor->file_strings[cursor->file_string_count++] = intern_string_n(start, length);
+            text_end_line(cursor);
+        }
+    }
+
+    if (!text_expect(cursor, "Health:") || !text_int_in(cursor, &loaded->health, 1, SAVE_MAX_STAT) ||
+        !text_end_line(cursor)) {
+        return text_fail(cursor, "Invalid health");
+    }
+    if (!text_expect(cursor, "Base Strength:") || !text_int_in(cursor, &loaded->base_strength, 1, SAVE_MAX_STAT) ||
+        !text_end_line(cursor)) {
+        return text_fail(cursor, "Invalid base strength");
+    }
+    if (!text_expect(cursor, "Position:") || !text_int_in(cursor, &loaded->x, 0, MAP_SIZE - 1) ||
+        !text_int_in(cursor, &loaded->y, 0, MAP_SIZE - 1) || !text_end_line(cursor)) {
+        return text_fail(cursor, "Invalid player position");
+    }
+    if (!text_expect(cursor, "Inventory Count:") || !text_int(cursor, &count) ||
+        count < 0 || count > MAX_INVENTORY || !text_end_line(cursor)) {
+        return text_fail(cursor, "Invalid inventory count");
+    }
+    loaded->inventory_count = count;
+    if (!text_expect(cursor, "Inventory:") || !text_end_line(cursor)) {
+        return text_fail(cursor, "Could not read Inventory header");
+    }
+    for (int i = 0; i < loaded->inventory_count; i++) {
+        if (!text_item(cursor, loaded_world, &loaded->inventory[i])) return 0;
+    }
+
+    if (!text_expect(cursor, "Creatures Left:") || !text_int(cursor, &loaded_world->creatures_left) ||
+        !text_end_line(cursor)) {
+        return text_fail(cursor, "Could not read creatures left");
+    }
+
+    // Place in the dungeon; saves from before floors hold a single one
+    if (text_expect(cursor, "Floor:")) {
+        if (!text_int(cursor, &loaded_world->floor)) return text_fail(cursor, "Could not read floor");
+        text_skip_blanks(cursor);
+        if (!text_expect(cursor, "of") || !text_int(cursor, &loaded_world->floor_count) ||
+            loaded_world->floor_count < 1 || loaded_world->floor_count > PACK_MAX_FLOORS ||
+            loaded_world->floor < 0 || loaded_world->floor >= loaded_world->floor_count || !text_end_line(cursor)) {
+            return text_fail(cursor, "Invalid floor");
+        }
+        if (!text_expect(cursor, "Stairs Room:") || !text_int(cursor, &loaded_world->stairs_room) ||
+            !text_end_line(cursor)) {
+            return text_fail(cursor, "Could not read stairs room");
+        }
+        if (!text_expect(cursor, "Unfinished Floors:") || !text_int(cursor, &loaded_world->floors_unfinished) ||
+            loaded_world->floors_unfinished < 0 || loaded_world->floors_unfinished >= loaded_world->floor_count ||
+            !text_end_line(cursor)) {
+            return text_fail(cursor, "Invalid unfinished floor count");
+        }
+    }
+    int room_count;
+    if (!text_expect(cursor, "Room Count:") || !text_int(cursor, &room_count) || room_count < 0 ||
+        !text_end_line(cursor)) {
+        return text_fail(cursor, "Could not read room count");
+    }
+
+    // Rooms
+    for (int i = 0; i < room_count; i++) {
+        int room_id, x, y, item_count;
+        if (!text_expect(cursor, "Room")) return text_fail(cursor, "Could not read room ID");
+        text_skip_blanks(cursor);
+        const char *number = cursor->pos;
+        if (!text_int(cursor, &room_id)) return text_fail(cursor, "Could not read room ID");
+        if (room_id != i) {
+            cursor->pos = number;
+            return text_fail(cursor, "Room out of order");
+        }
+        if (!text_expect(cursor, ":") || !text_end_line(cursor)) return text_fail(cursor, "Could not read room ID");
+        if (!text_expect(cursor, "Description:")) return text_fail(cursor, "Could not read room description");
+        text_skip_blanks(cursor);
+        text_rest_of_line(cursor, &start, &length);
+        int description = text_string_ref(cursor, start, length);
+        if (description == NO_ID || length == 0) {
+            cursor->pos = start;
+            return text_fail(cursor, "Invalid room description");
+        }
+        text_end_line(cursor);
+        if (!text_expect(cursor, "Position:") || !text_int(cursor, &x) || !text_int(cursor, &y) ||
+            !text_end_line(cursor)) {
+            return text_fail(cursor, "Could not read room position");
+        }
+        int room = world_add_room(loaded_world, x, y, description);
+
+        if (!text_expect(cursor, "Item Count:") || !text_int(cursor, &item_count) || item_count < 0 ||
+            !text_end_line(cursor)) {
+            return text_fail(cursor, "Could not read item count");
+        }
+        for (int j = 0; j < item_count; j++) {
+            int item;
+            if (!text_expect(cursor, "Item:")) return text_fail(cursor, "Could not read room item");
+            if (!text_item(cursor, loaded_world, &item)) return 0;
+            room_add_item(loaded_world, room, item);
+        }
+
+        // "Creature: None", or one "Creature:" line per creature
+        if (!text_expect(cursor, "Creature:")) return text_fail(cursor, "Could not read creature");
+        text_skip_blanks(cursor);
+        if (text_expect(cursor, "None")) {
+            if (!text_end_line(cursor)) return text_fail(cursor, "Unexpected text after creature");
+            continue;
+        }
+        do {
+            int health, strength;
+            if (!text_word(cursor, &start, &length) || !text_int_in(cursor, &health, 1, SAVE_MAX_STAT) ||
+                !text_int_in(cursor, &strength, 1, SAVE_MAX_STAT)) {
+                return text_fail(cursor, "Invalid creature data");
+            }
+            int name = text_string_ref(cursor, start, length);
+            if (name == NO_ID) {
+                cursor->pos = start;
+                return text_fail(cursor, "Invalid creature name");
+            }
+            if (!text_end_line(cursor)) return text_fail(cursor, "Unexpected text after creature");
+            room_add_creature(loaded_world, room, world_new_creature(loaded_world, name, health, strength));
+        } while (text_expect(cursor, "Creature:"));
+    }
+
+    if (loaded_world->stairs_room < NO_ID || loaded_world->stairs_room >= loaded_world->room_count) {
+        return text_fail(cursor, "Stairs room out of range");
+    }
+
+    // Discovered cells, one "x y" pair per line up to the end of the file
+    if (!text_expect(cursor, "Discovered Rooms:")) {
+        if (cursor->pos != cursor->end) return text_fail(cursor, "Could not read discovered rooms");
+        load_error("Warning: No discovered rooms found in save file.\n");
+        return 1;
+    }
+    if (!text_end_line(cursor)) return text_fail(cursor, "Could not read discovered rooms");
+    while (cursor->pos < cursor->end) {
+        int x, y;
+        if (!text_int(cursor, &x) || !text_int(cursor, &y) || !text_end_line(cursor)) {
+            return text_fail(cursor, "Could not read discovered cell");
+        }
+        set_discovered(loaded_world->discovered, x, y);
+    }
+    return 1;
+}
+
+// Parse a text save in one pass. Fills loaded and loaded_world; reports the
+// first problem, with its line and column, through load_error and returns 0.
+static int read_text_save(FILE *file, Player *loaded, World *loaded_world, SaveSize *size) {
+    long file_size;
+    if (fseek(file, 0, SEEK_END) != 0 || (file_size = ftell(file)) < 0 || fseek(file, 0, SEEK_SET) != 0) {
+        load_error("Error loading game: %s\n", strerror(errno));
+        return 0;
+    }
+    char *text = grow_array(NULL, file_size + 1, 1, MEM_SAVES);
+    if (fread(text, 1, file_size, file) != (size_t)file_size) {
+        load_error("Error: Could not read save file!\n");
+        mem_free(text);
+        return 0;
+    }
+    size->compressed = 0;
+    size->raw_bytes = size->file_bytes = file_size;
+
+    TextCursor cursor = { .pos = text, .end = text + file_size, .line_start = text, .line = 1 };
+    int ok = parse_text_save(&cursor, loaded, loaded_world);
+    mem_free(cursor.file_strings);
+    mem_free(text);
+    return ok;
+}
+
+// Parse a compressed save after its magic and version byte, one chunk at a
+// time. Fills the same state as read_text_save; reports problems through
+// load_error and returns 0.
+static int read_compressed_save(FILE *file, int version, Player *loaded, World *loaded_world, SaveSize *size) {
+    SaveStream stream;
+    LoadStrings table = { .ids = NULL };
+    save_stream_open(&stream, file, 0);
+
+    if (!save_get_text(&stream, loaded->nickname, sizeof(loaded->nickname))) {
+        load_error("Error: Could not read nickname! File might be corrupted.\n");
+        goto fail;
+    }
+    loaded->health = save_get_int(&stream);
+    loaded->base_strength = save_get_int(&stream);
+    loaded->x = save_get_int(&stream);
+    loaded->y = save_get_int(&stream);
+    uint32_t inventory_count = save_get_uint(&stream);
+    if (stream.error || inventory_count > MAX_INVENTORY) {
+        load_error("Error: Player information missing! File might be corrupted.\n");
+        goto fail;
+    }
+    if (loaded->health < 1 || loaded->health > SAVE_MAX_STAT || loaded->base_strength < 1 ||
+        loaded->base_strength > SAVE_MAX_STAT || loaded->x < 0 || loaded->x >= MAP_SIZE || loaded->y < 0 ||
+        loaded->y >= MAP_SIZE) {
+        load_error("Error: Invalid player health, strength or position! File might be corrupted.\n");
+        goto fail;
+    }
+    loaded->inventory_count = inventory_count;
+    for (int i = 0; i < loaded->inventory_count; i++) {
+        int name = save_get_string_ref(&stream, &table);
+        int attack_bonus = save_get_int(&stream);
+        int shield_bonus = save_get_int(&stream);
+        if (name == NO_ID || stream.error || attack_bonus < 0 || shield_bonus < 0 ||
+            attack_bonus > SAVE_MAX_STAT || shield_bonus > SAVE_MAX_STAT) {
+            load_error("Error: Could not read inventory item!\n");
+            goto fail;
+        }
+        loaded->inventory[i] = world_new_item(loaded_world, name, attack_bonus, shield_bonus);
+    }
+    loaded_world->creatures_left = save_get_int(&stream);
+    if (version >= 2) {
+        loaded_world->floor = save_get_int(&stream);
+        loaded_world->floor_count = save_get_int(&stream);
+        loaded_world->stairs_room = save_get_int(&stream);
+        loaded_world->floors_unfinished = save_get_int(&stream);
+        if (stream.error || loaded_world->floor_count < 1 || loaded_world->floor_count > PACK_MAX_FLOORS ||
+            loaded_world->floor < 0 || loaded_world->floor >= loaded_world->floor_count ||
+            loaded_world->floors_unfinished < 0 || loaded_world->floors_unfinished >= loaded_world->floor_count) {
+            load_error("Error: Invalid dungeon floor! File might be corrupted.\n");
+            goto fail;
+        }
+    }
+
+    uint32_t room_count = save_get_uint(&stream);
+    if (stream.error) {
+        load_error("Error: Could not read room count!\n");
+        goto fail;
+    }
+    for (uint32_t i = 0; i < room_count; i++) {
+        if (save_get_byte(&stream) != SAVE_RECORD_ROOM) {
+            load_error("Error: Could not read room %u! File might be truncated or corrupted.\n", i);
+            goto fail;
+        }
+        int x = save_get_int(&stream);
+        int y = save_get_int(&stream);
+        int description = save_get_string_ref(&stream, &table);
+        uint32_t item_count = save_get_uint(&stream);
+        if (description == NO_ID || stream.error) {
+            load_error("Error: Could not read room %u! File might be truncated or corrupted.\n", i);
+            goto fail;
+        }
+        int room = world_add_room(loaded_world, x, y, description);
+        for (uint32_t j = 0; j < item_count; j++) {
+            int name = save_get_string_ref(&stream, &table);
+            int attack_bonus = save_get_int(&stream);
+            int shield_bonus = save_get_int(&stream);
+            if (name == NO_ID || stream.error || attack_bonus < 0 || shield_bonus < 0 ||
+                attack_bonus > SAVE_MAX_STAT || shield_bonus > SAVE_MAX_STAT) {
+                load_error("Error: Could not read room item in room %u!\n", i);
+                goto fail;
+            }
+            room_add_item(loaded_world, room, world_new_item(loaded_world, name, attack_bonus, shield_bonus));
+        }
+        uint32_t creature_count = save_get_uint(&stream);
+        for (uint32_t j = 0; j < creature_count; j++) {
+            int name = save_get_string_ref(&stream, &table);
+            int health = save_get_int(&stream);
+            int strength = save_get_int(&stream);
+            if (name == NO_ID || stream.error || health < 1 || strength < 1 ||
+                health > SAVE_MAX_STAT || strength > SAVE_MAX_STAT) {
+                load_error("Error: Could not read creature data in room %u!\n", i);
+                goto fail;
+            }
+            room_add_creature(loaded_world, room, world_new_creature(loaded_world, name, health, strength));
+        }
+    }
+
+    if (loaded_world->stairs_room < NO_ID || loaded_world->stairs_room >= (int)room_count) {
+        load_error("Error: Stairs room out of range! File might be corrupted.\n");
+        goto fail;
+    }
+
+    if (save_get_byte(&stream) != SAVE_RECORD_DISCOVERED) {
+        load_error("Error: Could not read discovered rooms! File might be truncated or corrupted.\n");
+        goto fail;
+    }
+    uint32_t cells = save_get_uint(&stream);
+    for (uint32_t i = 0; i < cells && !stream.error; i++) {
+        int x = save_get_uint(&stream);
+        int y = save_get_uint(&stream);
+        set_discovered(loaded_world->discovered, x, y);
+    }
+
+    // The end record must close the last chunk, followed by the end chunk
+    if (save_get_byte(&stream) != SAVE_RECORD_END || stream.error ||
+        stream.raw_pos != stream.raw_used || save_fill_chunk(&stream) || !stream.finished) {
+        load_error("Error: Save file is truncated or has trailing data!\n");
+        goto fail;
+    }
+    size->raw_bytes = stream.raw_bytes;
+    size->file_bytes = SAVE_MAGIC_SIZE + 1 + stream.packed_bytes;
+    size->compressed = 1;
+    save_stream_close(&stream);
+    mem_free(table.ids);
+    return 1;
+
+fail:
+    save_stream_close(&stream);
+    mem_free(table.ids);
+    return 0;
+}
+
+// Read a text or compressed save, told apart by the magic at its start,
+// into loaded. Only loaded and the string table are touched, so saves can
+// be read on several threads and a failed load leaves the game as it was.
+int read_save_file(const char *filepath, SaveSnapshot *loaded, SaveSize *size) {
+    FILE *file = fopen(filepath, "rb");
+    if (!file) {
+        load_error("Error loading game: %s\n", strerror(errno));
+        load_error("Details: Could not open file %s. Ensure the file exists and is readable.\n", filepath);
+        return 0;
+    }
+
+    world_init(&loaded->world);
+    char magic[SAVE_MAGIC_SIZE + 1];
+    int ok;
+    if (fread(magic, 1, sizeof(magic), file) == sizeof(magic) && memcmp(magic, SAVE_MAGIC, SAVE_MAGIC_SIZE) == 0) {
+        if (magic[SAVE_MAGIC_SIZE] < 1 || magic[SAVE_MAGIC_SIZE] > SAVE_FORMAT_VERSION) {
+            load_error("Error: Unsupported save format version %d!\n", magic[SAVE_MAGIC_SIZE]);
+            ok = 0;
+        } else {
+            ok = read_compressed_save(file, magic[SAVE_MAGIC_SIZE], &loaded->player, &loaded->world, size);
+        }
+    } else {
+        ok = read_text_save(file, &loaded->player, &loaded->world, size);
+    }
+    fclose(file);
+    if (!ok) {
+        world_free(&loaded->world);
+        return 0;
+    }
+    loaded->string_count = string_count();
+    return 1;
+}
+
+// Floors of the dungeon a save belongs to, or 0 if it can't be read; its
+// errors are kept quiet
+int save_floor_count(const char *filepath) {
+    char error[LOAD_ERROR_LENGTH] = "";
+    char *previous = load_error_buffer;
+    load_error_buffer = error;
+    SaveSnapshot loaded;
+    SaveSize size;
+    int floor_count = 0;
+    if (read_save_file(filepath, &loaded, &size)) {
+        floor_count = loaded.world.floor_count;
+        world_free(&loaded.world);
+    }
+    load_error_buffer = previous;
+    return floor_count;
+}
+
+// Load a saved game; the current world and player are only replaced once
+// the whole file has been read successfully
+int load_game(Player *player, World *world, const char *filepath) {
+    autosave_flush();  // A queued save of this file must land first
+    autosave_report();
+
+    SaveSnapshot loaded;
+    SaveSize size;
+    loaded.player = *player;
+    double start = now_seconds();
+    if (!read_save_file(filepath, &loaded, &size)) {
+        return 0;
+    }
+    double seconds = now_seconds() - start;
+
+    // Commit the loaded state, releasing the previous world
+    world_free(world);
+    *world = loaded.world;
+    *player = loaded.player;
+    invalidate_map_frame();
+    mark_discovered(world, player->x, player->y);  // Older saves only list room cells
+    world_start_events(world, NULL);  // Saves don't keep pending events
+    dungeon_resume(world, filepath);
+
+    printf("Game loaded successfully from %s.\n", filepath);
+    if (size.compressed) {
+        printf("Read %.1f KB compressed from %.1f KB (%.2fx) at %.1f MB/s.\n", size.file_bytes / 1024.0,
+               size.raw_bytes / 1024.0, (double)size.raw_bytes / size.file_bytes,
+               seconds > 0 ? size.raw_bytes / seconds / 1e6 : 0.0);
+    }
+    return 1;
+}
+
+// Read only the nickname of a text or compressed save; a compressed save
+// stores it first, so only the first chunk is expanded
+static int read_save_nickname(const char *filepath, char *nickname, int size) {
+    FILE *file = fopen(filepath, "rb");
+    if (!file) return 0;
+    char magic[SAVE_MAGIC_SIZE + 1];
+    int ok;
+    if (fread(magic, 1, sizeof(magic), file) == sizeof(magic) && memcmp(magic, SAVE_MAGIC, SAVE_MAGIC_SIZE) == 0) {
+        SaveStream stream;
+        save_stream_open(&stream, file, 0);
+        ok = save_get_text(&stream, nickname, size);
+        save_stream_close(&stream);
+    } else {
+        rewind(file);
+        ok = fscanf(file, "Nickname: %49s\n", nickname) == 1;
+    }
+    fclose(file);
+    return ok;
+}
+
+int is_nickname_taken(const char *nickname) {
     for (int i = 0; i < saved_game_count; i++) {
-        FILE *file = fopen(saved_games[i], "r");
-        if (file) {
-            char saved_nickname[50];
-            if (fscanf(file, "Nickname: %49s\n", saved_nickname) == 1 && strcmp(saved_nickname, nickname) == 0) {
-                fclose(file);
+        char saved_nickname[50];
+        if (read_save_nickname(saved_games[i], saved_nickname, sizeof(saved_nickname)) &&
+            strcmp(saved_nickname, nickname) == 0) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+void free_resources(World *world, Player *player) {
+    // Inventory items live in the world's item pool
+    world_free(world);
+    player->inventory_count = 0;
+}
+
+// Multi-floor dungeon. Every floor is a World of its own, linked to the
+// next by a stairs room. The game loop holds the current floor; the floors
+// above and below it stay in memory, and the rest wait in floor files. A
+// streamer thread does the file work, so moving down a floor only swaps
+// worlds while the floor beyond is read or written in the background.
+
+// File of a stored floor: the session directory's copy, or the one beside
+// the save it was loaded from. Returns 0 if the path doesn't fit.
+static int floor_file_path(int floor, int in_save, char *path) {
+    int length = in_save
+        ? snprintf(path, MAX_FILENAME_LENGTH, "%s.floor%d%s", dungeon.save_path, floor, COMPRESSED_SAVE_EXTENSION)
+        : snprintf(path, MAX_FILENAME_LENGTH, "%s/floor%d%s", dungeon.directory, floor, COMPRESSED_SAVE_EXTENSION);
+    return length < MAX_FILENAME_LENGTH;
+}
+
+// Creatures or uncollected awards left on a floor
+static int floor_unfinished(World *world) {
+    if (world->creatures_left > 0) return 1;
+    for (int i = 0; i < world->item_count; i++) {
+        if (world->item_award[i] && world->item_room[i] != NO_ID) return 1;
+    }
+    return 0;
+}
+
+// Put a floor's stairs down in a random room other than the start; the
+// bottom floor has none
+static void place_stairs(World *world, int floor, int floor_count) {
+    world->floor = floor;
+    world->floor_count = floor_count;
+    world->stairs_room = floor < floor_count - 1 ? 1 + rand() % (world->room_count - 1) : NO_ID;
+}
+
+// Build a floor that has never been visited, or whose file was lost. Uses
+// no dungeon state, so it runs without the lock.
+static World *generate_floor(int floor, int floor_count) {
+    World *world = mem_alloc(sizeof(*world), MEM_WORLDS);
+    if (!world) {
+        perror("Failed to allocate memory for dungeon floor");
+        exit(EXIT_FAILURE);
+    }
+    world_init(world);
+    initialize_game(NULL, world);
+    place_stairs(world, floor, floor_count);
+    return world;
+}
+
+// Point target at source's file: a hard link when both are on one file
+// system, otherwise a copy. A missing or empty source removes target.
+static int link_floor_file(const char *source, const char *target) {
+    if (source[0] == '\0' || access(source, F_OK) != 0) {
+        return remove(target) == 0 || errno == ENOENT;
+    }
+    struct stat source_stat, target_stat;
+    if (stat(source, &source_stat) == 0 && stat(target, &target_stat) == 0 &&
+        source_stat.st_dev == target_stat.st_dev && source_stat.st_ino == target_stat.st_ino) {
+        return 1;  // Already linked; renaming a link over itself would leave the temporary one
+    }
+    char temp_path[MAX_FILENAME_LENGTH + 8];
+    snprintf(temp_path, sizeof(temp_path), "%s.tmp", target);
+    remove(temp_path);
+    if (link(source, temp_path) != 0) {
+        FILE *in = fopen(source, "rb");
+        FILE *out = in ? fopen(temp_path, "wb") : NULL;
+        int ok = out != NULL;
+        char buffer[SAVE_CHUNK_SIZE];
+        size_t length;
+        while (ok && (length = fread(buffer, 1, sizeof(buffer), in)) > 0) {
+            ok = fwrite(buffer, 1, length, out) == length;
+        }
+        ok = ok && !ferror(in);
+        if (in) fclose(in);
+        if (out && fclose(out) != 0) ok = 0;
+        if (!ok) {
+            remove(temp_path);
+            return 0;
+        }
+    }
+    if (rename(temp_path, target) != 0) {
+        remove(temp_path);
+        return 0;
+    }
+    return 1;
+}
+
+// File work of one job, done without the lock
+static int run_floor_job(FloorJob *job) {
+    // A floor file is a save whose player is a stand-in that passes the
+    // loader's checks
+    SaveSnapshot state = { .player = { .nickname = "floor", .health = 1, .base_strength = 1 } };
+    SaveSize size;
+    switch (job->kind) {
+    case FLOOR_JOB_STORE:
+    case FLOOR_JOB_EXPORT:
+        state.world = *job->world;
+        state.string_count = job->string_count;
+        return write_save_file(&state, job->target, NULL);
+    case FLOOR_JOB_LOAD:
+        // A floor the save never reached has no file and is generated instead
+        if (access(job->source, F_OK) != 0 || !read_save_file(job->source, &state, &size)) return 0;
+        job->world = mem_alloc(sizeof(World), MEM_WORLDS);
+        if (!job->world) {
+            perror("Failed to allocate memory for dungeon floor");
+            exit(EXIT_FAILURE);
+        }
+        *job->world = state.world;
+        job->unfinished = floor_unfinished(job->world);
+        return 1;
+    default:
+        return link_floor_file(job->source, job->target);
+    }
+}
+
+// World of a floor whose store has failed: in memory, or owned by a later
+// store job that hasn't run; NULL if the floor is in its file. Called with
+// the lock held.
+static World *pending_floor_world(int floor) {
+    Floor *slot = &dungeon.floors[floor];
+    if (slot->state == FLOOR_RESIDENT) return slot->world;
+    if (slot->state != FLOOR_STORING) return NULL;
+    for (FloorJob *job = dungeon.queue_head; job; job = job->next) {
+        if (job->kind == FLOOR_JOB_STORE && job->floor == floor) return job->world;
+    }
+    return NULL;
+}
+
+static void *dungeon_worker(void *arg) {
+    (void)arg;
+    char error[LOAD_ERROR_LENGTH];
+    load_error_buffer = error;  // Kept for the game loop to print
+    pthread_mutex_lock(&dungeon.lock);
+    while (1) {
+        while (!dungeon.queue_head && !dungeon.stopping) {
+            pthread_cond_wait(&dungeon.job_ready, &dungeon.lock);
+        }
+        FloorJob *job = dungeon.queue_head;
+        if (!job) {
+            break;  // Stopping and the queue is drained
+        }
+        dungeon.queue_head = job->next;
+        if (!dungeon.queue_head) dungeon.queue_tail = NULL;
+        if (job->kind == FLOOR_JOB_LINK && job->holds_floor) {
+            // The floor's write failed, so there is no file to link: write
+            // the floor instead, from memory or from the store retrying it
+            World *world = pending_floor_world(job->floor);
+            if (world) {
+                job->kind = FLOOR_JOB_EXPORT;
+                job->world = world;
+            }
+        }
+        dungeon.busy = 1;
+        pthread_mutex_unlock(&dungeon.lock);
+
+        error[0] = '\0';
+        int ok = run_floor_job(job);
+        if (ok && job->kind == FLOOR_JOB_STORE) {
+            world_release(job->world);
+            job->world = NULL;
+        }
+
+        pthread_mutex_lock(&dungeon.lock);
+        Floor *floor = &dungeon.floors[job->floor];
+        if (job->kind == FLOOR_JOB_STORE) {
+            dungeon.storing--;
+            if (ok) {
+                floor->state = FLOOR_STORED;
+                dungeon.floors_stored++;
+                dungeon.resident--;
+            } else {
+                floor->world = job->world;  // Keep it in memory instead
+                floor->state = FLOOR_RESIDENT;
+            }
+        } else if (job->kind == FLOOR_JOB_LOAD) {
+            if (ok) {
+                floor->world = job->world;
+                floor->unfinished = job->unfinished;
+                floor->state = FLOOR_RESIDENT;
+                floor->needs_events = 1;
+                dungeon.floors_loaded++;
+            } else {
+                floor->state = FLOOR_NEW;
+                dungeon.resident--;
+            }
+        }
+        if (job->holds_floor) {
+            floor->exporting--;
+        }
+        if (!ok && (job->kind != FLOOR_JOB_LOAD || access(job->source, F_OK) == 0)) {
+            dungeon.failures++;
+        }
+        if (error[0] != '\0' && dungeon.messages++ == 0) {
+            snprintf(dungeon.message, sizeof(dungeon.message), "Floor %d: %s", job->floor + 1, error);
+        }
+        dungeon.busy = 0;
+        pthread_cond_broadcast(&dungeon.job_done);
+        mem_free(job);
+    }
+    pthread_mutex_unlock(&dungeon.lock);
+    load_error_buffer = NULL;
+    return NULL;
+}
+
+// Print the errors the streamer kept since the last call. Only the game
+// loop calls this, so they don't land in the middle of the prompt. Called
+// with the lock held.
+static void report_floor_errors() {
+    if (dungeon.messages == 0) return;
+    printf("%s", dungeon.message);
+    if (dungeon.messages > 1) printf("(%d more floor file errors)\n", dungeon.messages - 1);
+    dungeon.messages = 0;
+}
+
+// Queue a job for the streamer thread, starting it on first use; called
+// with the lock held
+static void dungeon_queue(FloorJob *job) {
+    if (!dungeon.started) {
+        if (pthread_create(&dungeon.thread, NULL, dungeon_worker, NULL) != 0) {
+            perror("Failed to start floor streaming thread");
+            exit(EXIT_FAILURE);
+        }
+        dungeon.started = 1;
+        if (!dungeon.exit_registered) {
+            atexit(dungeon_stop);
+            dungeon.exit_registered = 1;
+        }
+    }
+    job->next = NULL;
+    if (dungeon.queue_tail) {
+        dungeon.queue_tail->next = job;
+    } else {
+        dungeon.queue_head = job;
+    }
+    dungeon.queue_tail = job;
+    pthread_cond_signal(&dungeon.job_ready);
+}
+
+static FloorJob *new_floor_job(int kind, int floor) {
+    FloorJob *job = mem_calloc(1, sizeof(FloorJob), MEM_WORLDS);
+    if (!job) {
+        perror("Failed to allocate memory for floor job");
+        exit(EXIT_FAILURE);
+    }
+    job->kind = kind;
+    job->floor = floor;
+    return job;
+}
+
+// Make the session directory on first use; returns 0 if it can't be made,
+// which is reported once
+static int make_floor_directory() {
+    if (dungeon.directory[0] != '\0') return 1;
+    if (dungeon.no_directory) return 0;
+    strcpy(dungeon.directory, FLOOR_DIR_TEMPLATE);
+    if (!mkdtemp(dungeon.directory)) {
+        perror("Could not create floor directory; floors will stay in memory");
+        dungeon.directory[0] = '\0';
+        dungeon.no_directory = 1;
+        return 0;
+    }
+    return 1;
+}
+
+// Write a resident floor out to the session directory; called with the
+// lock held. The floor stays in memory, counted as a failure, if there is
+// nowhere to put it.
+static void evict_floor(int floor) {
+    Floor *slot = &dungeon.floors[floor];
+    if (!make_floor_directory()) {
+        dungeon.failures++;
+        return;
+    }
+    FloorJob *job = new_floor_job(FLOOR_JOB_STORE, floor);
+    if (!floor_file_path(floor, 0, job->target)) {
+        mem_free(job);
+        dungeon.failures++;
+        return;
+    }
+    job->world = slot->world;
+    job->string_count = string_count();
+    slot->world = NULL;
+    slot->state = FLOOR_STORING;
+    slot->in_save = 0;
+    dungeon.storing++;
+    dungeon_queue(job);
+}
+
+// Start bringing a floor into memory: read its file in the background, or
+// generate it now if it has never been visited. Called with the lock held;
+// a floor is generated with the lock released, so the streamer carries on
+// meanwhile, and is claimed as loading until it is in place.
+static void prefetch_floor(int floor) {
+    Floor *slot = &dungeon.floors[floor];
+    if (slot->state == FLOOR_NEW) {
+        slot->state = FLOOR_LOADING;
+        dungeon.resident++;
+        int floor_count = dungeon.floor_count;
+        pthread_mutex_unlock(&dungeon.lock);
+        World *world = generate_floor(floor, floor_count);
+        pthread_mutex_lock(&dungeon.lock);
+        // A floor whose file was lost comes back new, which changes how many
+        // floors the current one counts as unfinished
+        int unfinished = floor_unfinished(world);
+        dungeon.unfinished_change += unfinished - slot->unfinished;
+        slot->unfinished = unfinished;
+        slot->world = world;
+        slot->state = FLOOR_RESIDENT;
+        dungeon.floors_generated++;
+    } else if (slot->state == FLOOR_STORED) {
+        FloorJob *job = new_floor_job(FLOOR_JOB_LOAD, floor);
+        floor_file_path(floor, slot->in_save, job->source);
+        slot->state = FLOOR_LOADING;
+        dungeon.resident++;
+        dungeon_queue(job);
+    }
+    if (dungeon.resident > dungeon.resident_max) dungeon.resident_max = dungeon.resident;
+}
+
+// Keep the floors next to the current one in memory and write out the ones
+// two floors away, which the last move left behind. Back-pressure: before
+// bringing a floor in, wait for writes while FLOOR_MAX_RESIDENT floors are
+// in memory. With no write pending there is nothing to wait for, e.g. when
+// floor files can't be written, and the floors stay. Called with the lock
+// held; returns 1 if it waited.
+static int settle_floors(int current) {
+    for (int floor = current - 2; floor <= current + 2; floor += 4) {
+        if (floor >= 0 && floor < dungeon.floor_count && dungeon.floors[floor].state == FLOOR_RESIDENT) {
+            evict_floor(floor);
+        }
+    }
+    int waited = 0;
+    for (int floor = current - 1; floor <= current + 1; floor += 2) {
+        if (floor < 0 || floor >= dungeon.floor_count) continue;
+        int state = dungeon.floors[floor].state;
+        if (state != FLOOR_NEW && state != FLOOR_STORED) continue;
+        while (dungeon.resident >= FLOOR_MAX_RESIDENT && dungeon.storing > 0) {
+            waited = 1;
+            pthread_cond_wait(&dungeon.job_done, &dungeon.lock);
+        }
+        prefetch_floor(floor);
+    }
+    return waited;
+}
+
+// Apply the floors generated again since the last call to the current
+// floor's count of unfinished floors. A floor file lost before it was ever
+// read leaves the count a guess, so it is kept in range; called with the
+// lock held.
+static void count_unfinished(World *world) {
+    world->floors_unfinished += dungeon.unfinished_change;
+    dungeon.unfinished_change = 0;
+    if (world->floors_unfinished < 0) world->floors_unfinished = 0;
+    if (world->floors_unfinished > world->floor_count - 1) world->floors_unfinished = world->floor_count - 1;
+}
+
+// Wait until the streamer has finished every queued job
+void dungeon_flush() {
+    pthread_mutex_lock(&dungeon.lock);
+    while (dungeon.queue_head || dungeon.busy) {
+        pthread_cond_wait(&dungeon.job_done, &dungeon.lock);
+    }
+    pthread_mutex_unlock(&dungeon.lock);
+}
+
+// Forget the dungeon: free the floors held in memory and delete the
+// session's floor files, which floors read back in leave behind too. The
+// current floor belongs to the game loop.
+static void dungeon_reset() {
+    dungeon_flush();
+    for (int floor = 0; floor < dungeon.floor_count; floor++) {
+        Floor *slot = &dungeon.floors[floor];
+        char path[MAX_FILENAME_LENGTH];
+        if (slot->state == FLOOR_RESIDENT) {
+            world_release(slot->world);
+        }
+        if (!slot->in_save && dungeon.directory[0] != '\0' && floor_file_path(floor, 0, path)) {
+            remove(path);
+        }
+    }
+    mem_free(dungeon.floors);
+    dungeon.floors = NULL;
+    dungeon.floor_count = 0;
+    dungeon.resident = 0;
+}
+
+static void dungeon_setup(int floor_count, int current) {
+    dungeon.floor_count = floor_count;
+    dungeon.floors = mem_calloc(floor_count, sizeof(Floor), MEM_WORLDS);
+    if (!dungeon.floors) {
+        perror("Failed to allocate memory for dungeon floors");
+        exit(EXIT_FAILURE);
+    }
+    dungeon.floors[current].state = FLOOR_CURRENT;
+    dungeon.current = current;
+    dungeon.resident = dungeon.resident_max = 1;
+    dungeon.unfinished_change = 0;
+}
+
+// Stack a new dungeon of floor_count floors under a world fresh from
+// initialize_game, which becomes the top floor
+void dungeon_start(World *world, int floor_count) {
+    dungeon_reset();
+    dungeon.save_path[0] = '\0';
+    dungeon_setup(floor_count, 0);
+    int has_creatures = content->creature_count > 0;
+    for (int floor = 1; floor < floor_count; floor++) {
+        dungeon.floors[floor].unfinished = has_creatures;
+    }
+    place_stairs(world, 0, floor_count);
+    world->floors_unfinished = has_creatures ? floor_count - 1 : 0;
+    pthread_mutex_lock(&dungeon.lock);
+    settle_floors(0);
+    count_unfinished(world);
+    pthread_mutex_unlock(&dungeon.lock);
+}
+
+// Rebuild the dungeon around a floor loaded from save_path; its other
+// floors are in the floor files beside the save
+void dungeon_resume(World *world, const char *save_path) {
+    dungeon_reset();
+    strncpy(dungeon.save_path, save_path, MAX_FILENAME_LENGTH - 1);
+    dungeon.save_path[MAX_FILENAME_LENGTH - 1] = '\0';
+    dungeon_setup(world->floor_count, world->floor);
+    // Until a floor is read, it counts as unfinished like a new one: the
+    // floors the save never reached have no file and are generated
+    int has_creatures = content->creature_count > 0;
+    for (int floor = 0; floor < world->floor_count; floor++) {
+        if (floor != world->floor) {
+            dungeon.floors[floor].state = FLOOR_STORED;
+            dungeon.floors[floor].in_save = 1;
+            dungeon.floors[floor].unfinished = has_creatures;
+        }
+    }
+    pthread_mutex_lock(&dungeon.lock);
+    settle_floors(world->floor);
+    count_unfinished(world);
+    pthread_mutex_unlock(&dungeon.lock);
+}
+
+// Move the player to the floor above or below, arriving at the stairs
+// that lead back. The floor left behind stays in memory as a neighbour.
+void change_floor(Player *player, World *world, int floor) {
+    double start = now_seconds();
+    Floor *slot = &dungeon.floors[floor];
+    int from = world->floor;
+
+    // Normally a neighbour is already in memory; otherwise wait for it, and
+    // for exports still writing it before the game loop changes it
+    pthread_mutex_lock(&dungeon.lock);
+    int stalled = 0;
+    while ((slot->state != FLOOR_RESIDENT && slot->state != FLOOR_NEW) || slot->exporting > 0) {
+        if (slot->state == FLOOR_STORED) prefetch_floor(floor);
+        stalled = 1;
+        pthread_cond_wait(&dungeon.job_done, &dungeon.lock);
+    }
+    if (slot->state == FLOOR_NEW) {
+        prefetch_floor(floor);  // Its file was missing or unreadable
+    }
+    World *arriving = slot->world;
+    if (slot->needs_events) {
+        world_start_events(arriving, NULL);  // Floor files don't keep events
+        slot->needs_events = 0;
+    }
+
+    // Carried items belong to the floor's item pool, so they move along
+    for (int i = 0; i < player->inventory_count; i++) {
+        int item = player->inventory[i];
+        player->inventory[i] = world_new_item(arriving, world->item_name[item], world->item_attack[item],
+                                              world->item_shield[item]);
+        world_free_item(world, item);
+    }
+
+    // Progress of the floor left behind, as seen from the one arrived at
+    int unfinished = floor_unfinished(world);
+    arriving->floors_unfinished = world->floors_unfinished + unfinished - slot->unfinished;
+    dungeon.floors[from].unfinished = unfinished;
+
+    // Swap: the floor left behind moves into its slot
+    World *leaving = mem_alloc(sizeof(*leaving), MEM_WORLDS);
+    if (!leaving) {
+        perror("Failed to allocate memory for dungeon floor");
+        exit(EXIT_FAILURE);
+    }
+    *leaving = *world;
+    dungeon.floors[from].world = leaving;
+    dungeon.floors[from].state = FLOOR_RESIDENT;
+    *world = *arriving;
+    mem_free(arriving);
+    slot->world = NULL;
+    slot->state = FLOOR_CURRENT;
+    dungeon.current = floor;
+    if (settle_floors(floor)) stalled = 1;  // The streamer is behind on writes
+    count_unfinished(world);
+
+    double seconds = now_seconds() - start;
+    dungeon.transitions++;
+    dungeon.transition_total += seconds;
+    if (seconds > dungeon.transition_max) dungeon.transition_max = seconds;
+    if (stalled) dungeon.stalls++;
+    report_floor_errors();
+    pthread_mutex_unlock(&dungeon.lock);
+
+    if (floor > from) {
+        player->x = 2;
+        player->y = 2;
+    } else {
+        player->x = world->room_x[world->stairs_room];
+        player->y = world->room_y[world->stairs_room];
+    }
+    mark_discovered(world, player->x, player->y);
+    invalidate_map_frame();
+}
+
+// descend / ascend: stairs down are in one room of each floor but the
+// last; stairs up are in the starting room of each floor but the first
+void use_stairs(Player *player, World *world, int down) {
+    int room = find_room_at_position(world, player->x, player->y);
+    if (down && (room == NO_ID || room != world->stairs_room)) {
+        printf("There are no stairs down here.\n");
+        return;
+    }
+    if (!down && (world->floor == 0 || player->x != 2 || player->y != 2)) {
+        printf("There are no stairs up here.\n");
+        return;
+    }
+    change_floor(player, world, world->floor + (down ? 1 : -1));
+    printf("You take the stairs %s to floor %d of %d.\n", down ? "down" : "up", world->floor + 1,
+           world->floor_count);
+    display_room(world, find_room_at_position(world, player->x, player->y));
+}
+
+// Queue copies of every floor but the current one beside a save at
+// filepath, as "<filepath>.floor<n>.dz". The streamer writes them after
+// the jobs already queued, so each copy shows its floor as of this call:
+// floors other than the current one don't change, and a floor change
+// waits for the exports of the floor it moves to. Nothing is copied here.
+void dungeon_export(const char *filepath) {
+    pthread_mutex_lock(&dungeon.lock);
+    for (int floor = 0; floor < dungeon.floor_count; floor++) {
+        Floor *slot = &dungeon.floors[floor];
+        if (slot->state == FLOOR_CURRENT) continue;
+        FloorJob *job = new_floor_job(FLOOR_JOB_LINK, floor);
+        int length = snprintf(job->target, MAX_FILENAME_LENGTH, "%s.floor%d%s", filepath, floor,
+                              COMPRESSED_SAVE_EXTENSION);
+        if (length >= MAX_FILENAME_LENGTH) {
+            mem_free(job);
+            dungeon.failures++;
+            continue;
+        }
+        job->string_count = string_count();
+        if (slot->state == FLOOR_RESIDENT) {
+            job->kind = FLOOR_JOB_EXPORT;
+            job->world = slot->world;
+        } else if (slot->state != FLOOR_NEW) {
+            floor_file_path(floor, slot->in_save, job->source);
+            if (strcmp(job->source, job->target) == 0) {
+                mem_free(job);  // Already there: the floor is unchanged since it was loaded from this save
+                continue;
+            }
+        }
+        if (slot->state == FLOOR_RESIDENT || slot->state == FLOOR_STORING) {
+            job->holds_floor = 1;  // A floor being stored is written instead if the store fails
+            slot->exporting++;
+        }
+        dungeon_queue(job);
+    }
+    pthread_mutex_unlock(&dungeon.lock);
+}
+
+// Stop reading floors from the files beside the save at filepath, which is
+// about to be deleted: its stored floors are linked into the session
+// directory first. Returns 0 if one couldn't be, so the files must stay.
+int dungeon_release_save(const char *filepath) {
+    pthread_mutex_lock(&dungeon.lock);
+    struct stat ours, theirs;
+    int same = dungeon.save_path[0] != '\0' &&
+               (strcmp(dungeon.save_path, filepath) == 0 ||
+                (stat(dungeon.save_path, &ours) == 0 && stat(filepath, &theirs) == 0 &&
+                 ours.st_dev == theirs.st_dev && ours.st_ino == theirs.st_ino));
+    int ok = 1;
+    if (same) {
+        while (dungeon.queue_head || dungeon.busy) {
+            pthread_cond_wait(&dungeon.job_done, &dungeon.lock);  // Reads from the save finish first
+        }
+        for (int floor = 0; floor < dungeon.floor_count; floor++) {
+            Floor *slot = &dungeon.floors[floor];
+            if (!slot->in_save) continue;
+            if (slot->state == FLOOR_STORED) {
+                char source[MAX_FILENAME_LENGTH], target[MAX_FILENAME_LENGTH];
+                if (!make_floor_directory() || !floor_file_path(floor, 1, source) ||
+                    !floor_file_path(floor, 0, target) || !link_floor_file(source, target)) {
+                    ok = 0;
+                    continue;
+                }
+            }
+            slot->in_save = 0;
+        }
+        if (ok) dungeon.save_path[0] = '\0';
+    }
+    pthread_mutex_unlock(&dungeon.lock);
+    return ok;
+}
+
+// Drain the streamer, stop it and delete the session's floor files;
+// registered with atexit like autosave_stop
+void dungeon_stop() {
+    if (dungeon.started) {
+        pthread_mutex_lock(&dungeon.lock);
+        dungeon.stopping = 1;
+        pthread_cond_signal(&dungeon.job_ready);
+        pthread_mutex_unlock(&dungeon.lock);
+        pthread_join(dungeon.thread, NULL);
+        dungeon.started = 0;
+        dungeon.stopping = 0;
+    }
+    dungeon_reset();
+    if (dungeon.directory[0] != '\0') {
+        rmdir(dungeon.directory);
+        dungeon.directory[0] = '\0';
+    }
+    dungeon.no_directory = 0;
+}
+
+void display_floor_stats() {
+    pthread_mutex_lock(&dungeon.lock);
+    report_floor_errors();
+    printf("Floors in memory: %d of %d (peak %d); stored %d, loaded %d, generated %d, failed %d\n",
+           dungeon.resident, dungeon.floor_count, dungeon.resident_max, dungeon.floors_stored,
+           dungeon.floors_loaded, dungeon.floors_generated, dungeon.failures);
+    if (dungeon.transitions > 0) {
+        printf("Floor changes: %d, avg %.3f ms, max %.3f ms, %d waited for the streamer\n", dungeon.transitions,
+               dungeon.transition_total * 1e3 / dungeon.transitions, dungeon.transition_max * 1e3,
+               dungeon.stalls);
+    }
+    pthread_mutex_unlock(&dungeon.lock);
+}
+
+// Copy of the allocation counters. Each is read on its own, so blocks
+// other threads are allocating at the time may show in one and not yet in
+// another; with the other threads done, the copy is exact.
+static MemStats mem_snapshot() {
+    MemStats stats;
+    for (int tag = 0; tag < MEM_TAGS; tag++) {
+        stats.live_bytes[tag] = atomic_load_explicit(&mem_stats.live_bytes[tag], memory_order_relaxed);
+        stats.live_blocks[tag] = atomic_load_explicit(&mem_stats.live_blocks[tag], memory_order_relaxed);
+        stats.peak_bytes[tag] = atomic_load_explicit(&mem_stats.peak_bytes[tag], memory_order_relaxed);
+    }
+    stats.total_bytes = atomic_load_explicit(&mem_stats.total_bytes, memory_order_relaxed);
+    stats.total_peak = atomic_load_explicit(&mem_stats.total_peak, memory_order_relaxed);
+    return stats;
+}
+
+// Live and peak bytes by tag, with the object counts of the current floor
+// next to its own tags
+void display_memory_stats(World *world) {
+    long long objects[MEM_TAGS];
+    for (int tag = 0; tag < MEM_TAGS; tag++) {
+        objects[tag] = -1;
+    }
+    objects[MEM_ROOMS] = world->room_count;
+    objects[MEM_ITEMS] = 0;
+    for (int item = 0; item < world->item_count; item++) {
+        objects[MEM_ITEMS] += world->item_name[item] != NO_ID;
+    }
+    objects[MEM_CREATURES] = 0;
+    for (int creature = 0; creature < world->creature_count; creature++) {
+        objects[MEM_CREATURES] += world->creature_name[creature] != NO_ID;
+    }
+    objects[MEM_EVENTS] = world->event_pending;
+    objects[MEM_NAMES] = string_count();
+
+    MemStats stats = mem_snapshot();
+    printf("Memory in use: %.1f KB, peak %.1f KB\n", stats.total_bytes / 1024.0, stats.total_peak / 1024.0);
+    printf("%-10s %8s %12s %8s %12s\n", "Type", "Objects", "Bytes", "Blocks", "Peak bytes");
+    for (int tag = 0; tag < MEM_TAGS; tag++) {
+        char count[24] = "-";
+        if (objects[tag] >= 0) snprintf(count, sizeof(count), "%lld", objects[tag]);
+        printf("%-10s %8s %12lld %8lld %12lld\n", mem_tag_names[tag], count, stats.live_bytes[tag],
+               stats.live_blocks[tag], stats.peak_bytes[tag]);
+    }
+    printf("Objects are those of the current floor; bytes cover every floor in memory.\n");
+}
+
+// Called once everything has been freed: report what is still allocated
+// and return its size, so callers can fail on leaks
+long long mem_leak_report() {
+    MemStats stats = mem_snapshot();
+    if (stats.total_bytes == 0) {
+        return 0;
+    }
+    fprintf(stderr, "Memory leak: %lld bytes still allocated at exit\n", stats.total_bytes);
+    for (int tag = 0; tag < MEM_TAGS; tag++) {
+        if (stats.live_blocks[tag] != 0) {
+            fprintf(stderr, "  %-10s %lld bytes in %lld blocks\n", mem_tag_names[tag], stats.live_bytes[tag],
+                    stats.live_blocks[tag]);
+        }
+    }
+    return stats.total_bytes;
+}
+
+int is_discovered(World *world, int x, int y) {
+    if (x < 0 || x >= MAP_SIZE || y < 0 || y >= MAP_SIZE) return 0;
+    int bit = (y % MAP_CHUNK_SIZE) * MAP_CHUNK_SIZE + x % MAP_CHUNK_SIZE;
+    return (world->discovered[y / MAP_CHUNK_SIZE][x / MAP_CHUNK_SIZE] >> bit) & 1;
+}
+
+// Set a cell's bit in an exploration bitset; returns 1 if it was clear
+int set_discovered(uint64_t bits[MAP_CHUNKS][MAP_CHUNKS], int x, int y) {
+    if (x < 0 || x >= MAP_SIZE || y < 0 || y >= MAP_SIZE) return 0;
+    int bit = (y % MAP_CHUNK_SIZE) * MAP_CHUNK_SIZE + x % MAP_CHUNK_SIZE;
+    uint64_t mask = (uint64_t)1 << bit;
+    uint64_t *chunk = &bits[y / MAP_CHUNK_SIZE][x / MAP_CHUNK_SIZE];
+    if (*chunk & mask) return 0;
+    *chunk |= mask;
+    return 1;
+}
+
+void mark_discovered(World *world, int x, int y) {
+    set_discovered(world->discovered, x, y);
+}
+
+void clear_discovered(World *world) {
+    memset(world->discovered, 0, sizeof(world->discovered));
+}
+
+void invalidate_map_frame() {
+    map_frame.valid = 0;
+}
+
+// Render one full map row into the frame cache
+static void render_map_row(World *world, Player *player, int y) {
+    char *out = map_frame.rows[y];
+    for (int x = 0; x < MAP_SIZE; x++, out += MAP_CELL_WIDTH) {
+        const char *cell;
+        if (player->x == x && player->y == y) {
+            cell = "[P]";  // Player's current position
+        } else if (!is_discovered(world, x, y)) {
+            cell = "   ";  // Unexplored
+        } else if (x == 2 && y == 2) {
+            cell = "[I]";  // Starting room
+        } else if (world->cell_room[y][x] != NO_ID && world->cell_room[y][x] == world->stairs_room) {
+            cell = "[S]";  // Stairs down
+        } else if (world->cell_room[y][x] != NO_ID) {
+            cell = "[R]";  // Room exists
+        } else {
+            cell = "[X]";  // No room at this position
+        }
+        memcpy(out, cell, MAP_CELL_WIDTH);
+    }
+    *out = '\0';
+    map_frame.dirty[y] = 0;
+}
+
+// Bring the cached frame up to date, re-rendering only rows that changed;
+// returns the number of rows rendered
+static int update_map_frame(World *world, Player *player) {
+    int rendered = 0;
+    if (!map_frame.valid) {
+        memset(map_frame.dirty, 1, sizeof(map_frame.dirty));
+    } else {
+        if (map_frame.player_x != player->x || map_frame.player_y != player->y) {
+            map_frame.dirty[map_frame.player_y] = 1;
+            map_frame.dirty[player->y] = 1;
+        }
+        // Rows whose exploration bits changed since the frame was drawn;
+        // each byte of a chunk mask is one chunk row
+        for (int cy = 0; cy < MAP_CHUNKS; cy++) {
+            for (int cx = 0; cx < MAP_CHUNKS; cx++) {
+                uint64_t changed = map_frame.discovered[cy][cx] ^ world->discovered[cy][cx];
+                for (int row = 0; changed; row++, changed >>= MAP_CHUNK_SIZE) {
+                    if (changed & (((uint64_t)1 << MAP_CHUNK_SIZE) - 1)) map_frame.dirty[cy * MAP_CHUNK_SIZE + row] = 1;
+                }
+            }
+        }
+    }
+    for (int y = 0; y < MAP_SIZE; y++) {
+        if (map_frame.dirty[y]) {
+            render_map_row(world, player, y);
+            rendered++;
+        }
+    }
+    memcpy(map_frame.discovered, world->discovered, sizeof(map_frame.discovered));
+    map_frame.player_x = player->x;
+    map_frame.player_y = player->y;
+    map_frame.valid = 1;
+    return rendered;
+}
+
+// Clamp a square viewport around the player so large maps stay readable;
+// maps no wider than the viewport are shown whole
+static int map_viewport(Player *player, int *x0, int *y0) {
+    int view = 2 * MAP_VIEW_RADIUS + 1;
+    *x0 = *y0 = 0;
+    if (MAP_SIZE <= view) return MAP_SIZE;
+    *x0 = player->x - MAP_VIEW_RADIUS;
+    *y0 = player->y - MAP_VIEW_RADIUS;
+    if (*x0 < 0) *x0 = 0;
+    if (*y0 < 0) *y0 = 0;
+    if (*x0 > MAP_SIZE - view) *x0 = MAP_SIZE - view;
+    if (*y0 > MAP_SIZE - view) *y0 = MAP_SIZE - view;
+    return view;
+}
+
+void display_map(World *world, Player *player) {
+    update_map_frame(world, player);
+    int x0, y0;
+    int size = map_viewport(player, &x0, &y0);
+    printf("Map:\n");
+    for (int y = y0; y < y0 + size; y++) {
+        fwrite(map_frame.rows[y] + x0 * MAP_CELL_WIDTH, 1, size * MAP_CELL_WIDTH, stdout);
+        putchar('\n');
+    }
+}
+
+void display_help() {
+    printf("Available commands:\n");
+    printf("- move <direction>: Move in a direction (up, down, left, right).\n");
+    printf("- look: Examine the current location.\n");
+    printf("- inventory: View your inventory.\n");
+    printf("- pickup <item>: Pick up an item in the room.\n");
+    printf("- attack: Attack the creature in the room.\n");
+    printf("- descend / ascend: Take the stairs to the floor below or above.\n");
+    printf("- status: Display player status.\n");
+    printf("- save <filepath>: Save the game in the background (compressed if it ends in %s).\n",
+           COMPRESSED_SAVE_EXTENSION);
+    printf("- autosave: Save to autosave_<nickname>.txt now (also done every %d commands).\n", AUTOSAVE_INTERVAL);
+    printf("- savestats: Show snapshot pause and save times, and floor streaming.\n");
+    printf("- memstats: Show memory in use and its peak by type.\n");
+    printf("- load <filepath>: Load a saved game.\n");
+    printf("- list: List all saved games.\n");
+    printf("- delete <filepath>: Delete a saved game.\n");
+    printf("- map: Display the map.\n");
+    printf("- help: Display this help message.\n");
+    printf("- exit: Exit the game.\n");
+}
+
+void display_status(Player *player, World *world) {
+    int total_attack = compute_total_attack(player, world);
+    int total_shield = compute_total_shield(player, world);
+    printf("Player Status:\n");
+    printf("Floor: %d of %d\n", world->floor + 1, world->floor_count);
+    printf("Health: %d\n", player->health);
+    printf("Attack Power: %d\n", total_attack);
+    printf("Shield Power: %d\n", total_shield);
+}
+
+int compute_total_attack(Player *player, World *world) {
+    int total_attack = player->base_strength;
+    for (int i = 0; i < player->inventory_count; i++) {
+        total_attack += world->item_attack[player->inventory[i]];
+    }
+    return total_attack;
+}
+
+int compute_total_shield(Player *player, World *world) {
+    int total_shield = 0;  // Initial shield value
+    for (int i = 0; i < player->inventory_count; i++) {
+        total_shield += world->item_shield[player->inventory[i]];
+    }
+    return total_shield;
+}
+
+// Benchmarks
+
+// Bulk save checker: validates many saves in parallel with the same parsers
+// as load_game and can convert them between formats in the same pass
+typedef struct SaveCheck {
+    char **paths;
+    int path_count, path_capacity;
+    int next;                      // Next path to hand to a worker
+    const char *convert_extension; // Target format, NULL to only validate
+    int convert_compressed;
+    pthread_mutex_t lock;          // Guards next, the counters and output
+    int valid, corrupt, converted, convert_failed;
+    long long bytes;
+} SaveCheck;
+
+static void save_check_add(SaveCheck *check, const char *path) {
+    if (check->path_count == check->path_capacity) {
+        check->path_capacity = check->path_capacity ? check->path_capacity * 2 : 64;
+        check->paths = grow_array(check->paths, check->path_capacity, sizeof(char *), MEM_SAVES);
+    }
+    size_t length = strlen(path) + 1;
+    check->paths[check->path_count] = mem_alloc(length, MEM_SAVES);
+    if (!check->paths[check->path_count]) {
+        perror("Failed to allocate memory for save path");
+        exit(EXIT_FAILURE);
+    }
+    memcpy(check->paths[check->path_count], path, length);
+    check->path_count++;
+}
+
+// A floor file beside a save, "<save>.floor<n>.dz", which holds one floor of
+// the save's dungeon rather than a game
+static int is_floor_file_path(const char *path) {
+    if (!is_compressed_save_path(path)) return 0;
+    const char *end = path + strlen(path) - strlen(COMPRESSED_SAVE_EXTENSION);
+    const char *digits = end;
+    while (digits > path && digits[-1] >= '0' && digits[-1] <= '9') digits--;
+    return digits < end && digits - path >= 6 && strncmp(digits - 6, ".floor", 6) == 0;
+}
+
+// Queue a save, or every save in a directory: files ending in .txt or the
+// compressed extension, except the catalog itself and floor files
+static void save_check_add_path(SaveCheck *check, const char *path) {
+    DIR *dir = opendir(path);
+    if (!dir) {
+        save_check_add(check, path);  // A file; unreadable ones are reported by the worker
+        return;
+    }
+    struct dirent *entry;
+    while ((entry = readdir(dir)) != NULL) {
+        size_t length = strlen(entry->d_name);
+        int text = length > 4 && strcmp(entry->d_name + length - 4, ".txt") == 0;
+        if ((!text && !is_compressed_save_path(entry->d_name)) || strcmp(entry->d_name, "saved_game.txt") == 0 ||
+            is_floor_file_path(entry->d_name)) {
+            continue;
+        }
+        char file_path[MAX_FILENAME_LENGTH * 2];
+        snprintf(file_path, sizeof(file_path), "%s/%s", path, entry->d_name);
+        save_check_add(check, file_path);
+    }
+    closedir(dir);
+}
+
+// Path of a save converted to extension: the source with its own .txt or
+// compressed extension replaced
+static void converted_save_path(const char *path, const char *extension, char *out, size_t size) {
+    size_t length = strlen(path);
+    if (is_compressed_save_path(path)) {
+        length -= strlen(COMPRESSED_SAVE_EXTENSION);
+    } else if (length > 4 && strcmp(path + length - 4, ".txt") == 0) {
+        length -= 4;
+    }
+    snprintf(out, size, "%.*s%s", (int)length, path, extension);
+}
+
+// Give a converted save its original's floor files, which are compressed
+// in either format. The buffers hold any save path with its floor suffix;
+// floor files longer than MAX_FILENAME_LENGTH, which the game couldn't
+// read, fail the conversion. Returns 0, with none of them left, if one
+// couldn't be linked.
+static int convert_floor_files(const char *path, const char *target, World *world) {
+    char source_floor[MAX_FILENAME_LENGTH * 2 + 32], target_floor[MAX_FILENAME_LENGTH * 2 + 32];
+    for (int floor = 0; floor < world->floor_count; floor++) {
+        if (floor == world->floor) continue;
+        int length = snprintf(source_floor, sizeof(source_floor), "%s.floor%d%s", path, floor,
+                              COMPRESSED_SAVE_EXTENSION);
+        int target_length = snprintf(target_floor, sizeof(target_floor), "%s.floor%d%s", target, floor,
+                                     COMPRESSED_SAVE_EXTENSION);
+        if (length >= MAX_FILENAME_LENGTH || target_length >= MAX_FILENAME_LENGTH ||
+            !link_floor_file(source_floor, target_floor)) {
+            for (int linked = 0; linked < floor; linked++) {
+                snprintf(target_floor, sizeof(target_floor), "%s.floor%d%s", target, linked,
+                         COMPRESSED_SAVE_EXTENSION);
+                remove(target_floor);
+            }
+            return 0;
+        }
+    }
+    return 1;
+}
+
+static void *save_check_worker(void *arg) {
+    SaveCheck *check = arg;
+    char error[LOAD_ERROR_LENGTH];
+    load_error_buffer = error;
+    while (1) {
+        pthread_mutex_lock(&check->lock);
+        int index = check->next++;
+        pthread_mutex_unlock(&check->lock);
+        if (index >= check->path_count) break;
+        const char *path = check->paths[index];
+
+        SaveSnapshot loaded;
+        SaveSize size = { .file_bytes = 0 };
+        error[0] = '\0';
+        int ok = read_save_file(path, &loaded, &size);
+        int converted = 0;
+        char target[MAX_FILENAME_LENGTH * 2];
+        if (ok && check->convert_extension &&
+            is_compressed_save_path(path) != check->convert_compressed) {
+            converted_save_path(path, check->convert_extension, target, sizeof(target));
+            FILE *existing = fopen(target, "r");
+            if (existing) {
+                fclose(existing);
+                converted = -2;  // Never overwrite another save
+            } else {
+                converted = write_save_file(&loaded, target, NULL) ? 1 : -1;
+                if (converted == 1 && !convert_floor_files(path, target, &loaded.world)) {
+                    remove(target);  // Not without its floors
+                    converted = -1;
+                }
+            }
+        }
+        if (ok) {
+            world_free(&loaded.world);
+        }
+
+        pthread_mutex_lock(&check->lock);
+        check->bytes += size.file_bytes;
+        if (ok) {
+            check->valid++;
+        } else {
+            check->corrupt++;
+            printf("CORRUPT %s: %s", path, error[0] ? error : "Unknown error\n");
+        }
+        if (converted == 1) {
+            check->converted++;
+            printf("Converted %s -> %s\n", path, target);
+        } else if (converted == -1) {
+            check->convert_failed++;
+            printf("FAILED to convert %s -> %s\n", path, target);
+        } else if (converted == -2) {
+            printf("Skipped %s: %s already exists\n", path, target);
+        }
+        pthread_mutex_unlock(&check->lock);
+    }
+    load_error_buffer = NULL;
+    return NULL;
+}
+
+// --check [--threads N] [--convert text|compressed] [path...]: validate the
+// given saves and directories, or every save in saved_game.txt
+int run_save_check(int argc, char *argv[]) {
+    SaveCheck check = { .lock = PTHREAD_MUTEX_INITIALIZER };
+    int thread_count = 0;
+    for (int i = 0; i < argc; i++) {
+        if (strcmp(argv[i], "--threads") == 0 && i + 1 < argc) {
+            thread_count = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--convert") == 0 && i + 1 < argc) {
+            i++;
+            if (strcmp(argv[i], "text") == 0) {
+                check.convert_extension = ".txt";
+            } else if (strcmp(argv[i], "compressed") == 0) {
+                check.convert_extension = COMPRESSED_SAVE_EXTENSION;
+                check.convert_compressed = 1;
+            } else {
+                printf("Unknown format: %s (use text or compressed)\n", argv[i]);
                 return 1;
             }
-            fclose(file);
+        } else {
+            save_check_add_path(&check, argv[i]);
         }
     }
-    return 0;
-}
+    if (check.path_count == 0) {
+        // No paths given: check the catalog
+        FILE *catalog = fopen("saved_game.txt", "r");
+        char path[MAX_FILENAME_LENGTH];
+        while (catalog && fscanf(catalog, "%255s", path) == 1) {
+            save_check_add(&check, path);
+        }
+        if (catalog) fclose(catalog);
+    }
+    if (thread_count <= 0) {
+#ifdef _SC_NPROCESSORS_ONLN
+        thread_count = (int)sysconf(_SC_NPROCESSORS_ONLN);
+#endif
+        if (thread_count <= 0) thread_count = 1;
+    }
+    if (thread_count > CHECK_MAX_THREADS) thread_count = CHECK_MAX_THREADS;
+    if (thread_count > check.path_count) thread_count = check.path_count > 0 ? check.path_count : 1;
 
-void free_resources(Room *rooms[], int room_count, Player *player) {
-    for (int i = 0; i < room_count; i++) {
-        if (rooms[i]) {
-            free(rooms[i]->description);
-            for (int j = 0; j < rooms[i]->item_count; j++) {
-                free(rooms[i]->items[j]->name);
-                free(rooms[i]->items[j]);
-            }
-            if (rooms[i]->creature) {
-                free(rooms[i]->creature->name);
-                free(rooms[i]->creature);
-            }
-            free(rooms[i]);
+    pthread_t threads[CHECK_MAX_THREADS];
+    double start = now_seconds();
+    int started = 0;
+    for (; started < thread_count; started++) {
+        if (pthread_create(&threads[started], NULL, save_check_worker, &check) != 0) {
+            perror("Failed to start save check thread");
+            break;
         }
     }
+    if (started == 0) {
+        save_check_worker(&check);  // Check on this thread instead
+    }
+    for (int i = 0; i < started; i++) {
+        pthread_join(threads[i], NULL);
+    }
+    double seconds = now_seconds() - start;
+
+    printf("Checked %d saves on %d threads in %.3f s: %d valid, %d corrupt\n", check.path_count,
+           started ? started : 1, seconds, check.valid, check.corrupt);
+    if (check.convert_extension) {
+        printf("Converted %d saves to %s (%d failed)\n", check.converted, check.convert_extension,
+               check.convert_failed);
+    }
+    if (seconds > 0) {
+        printf("Throughput: %.1f files/s, %.1f MB/s\n", check.path_count / seconds, check.bytes / seconds / 1e6);
+    }
+
+    for (int i = 0; i < check.path_count; i++) {
+        mem_free(check.paths[i]);
+    }
+    mem_free(check.paths);
+    free_string_table();
+    return check.corrupt > 0 || check.convert_failed > 0;
+}
+
+// Monte-Carlo tree search bot for automated QA and difficulty tuning. It
+// plays whole games, every floor of the dungeon, through the same rule
+// cores as the commands. Each pool thread grows its own tree from a clone
+// of the current game (root parallelization) and the root statistics are
+// summed to pick an action.
+static const char *bot_action_names[BOT_ACTIONS] = {
+    "move up", "move down", "move left", "move right", "pickup", "attack", "return to start", "take the stairs"
+};
+static const int bot_dx[4] = { 0, 0, -1, 1 };
+static const int bot_dy[4] = { -1, 1, 0, 0 };
+
+// One node of a search tree. Children are handles into the searching
+// thread's node array, NO_ID until expanded. The tree is open loop: nodes
+// stand for action sequences, and fights are re-rolled on every visit.
+typedef struct BotNode {
+    int children[BOT_ACTIONS];
+    int visits;
+    double value;                  // Sum of rollout results through the node
+} BotNode;
+
+// A bot's dungeon: every floor stays in memory, so searches fork it without
+// the floor streamer. A fork copies the floor it is on and borrows the
+// others until it takes the stairs to them.
+typedef struct BotGame {
+    World **floors;
+    unsigned char *owned;          // Floors this game copied and must release
+    unsigned char *unfinished;     // As Floor.unfinished: left when last visited
+    int floor_count, capacity;
+    int current;
+} BotGame;
+
+// Per-thread search state; node storage is reused between decisions
+typedef struct BotSearch {
+    struct BotPool *pool;
+    int index;
+    BotNode *nodes;
+    int node_count, node_capacity;
+    BotGame sim;                   // Game played by the current rollout
+    uint64_t rng;
+    int rollouts;                  // Rollouts run for the current decision
+    int root_visits[BOT_ACTIONS];
+    double root_value[BOT_ACTIONS];
+} BotSearch;
+
+typedef struct BotPool {
+    pthread_t threads[BOT_MAX_THREADS];
+    BotSearch searches[BOT_MAX_THREADS];
+    int thread_count;              // Searches per decision
+    int started;                   // Pool threads running, 0 to search inline
+    pthread_mutex_t lock;
+    pthread_cond_t start, done;
+    int generation;                // Bumped for each decision
+    int running;                   // Threads still searching
+    int stop;
+
+    // The decision being searched
+    const Player *player;
+    const BotGame *game;
+    int rollouts;                  // Budget split across threads, if no deadline
+    double deadline;               // Wall-clock limit, 0 for none
+    uint64_t seed;
+} BotPool;
+
+// Scramble a seed so nearby seeds give unrelated xorshift streams
+static uint64_t mix_seed(uint64_t x) {
+    x += 0x9E3779B97F4A7C15ULL;
+    x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    x = (x ^ (x >> 27)) * 0x94D049BB133111EBULL;
+    x ^= x >> 31;
+    return x ? x : 1;  // xorshift state must not be zero
+}
+
+// Build a new game's dungeon: the top floor for the player, then the
+// floors below, as dungeon_start and the streamer would
+static void bot_game_start(BotGame *game, Player *player) {
+    int floor_count = content->floor_count;
+    game->floors = mem_calloc(floor_count, sizeof(World *), MEM_BOT);
+    game->owned = mem_calloc(floor_count, 1, MEM_BOT);
+    game->unfinished = mem_calloc(floor_count, 1, MEM_BOT);
+    if (!game->floors || !game->owned || !game->unfinished) {
+        perror("Failed to allocate bot dungeon");
+        exit(EXIT_FAILURE);
+    }
+    game->floor_count = game->capacity = floor_count;
+    game->current = 0;
+    World *top = mem_alloc(sizeof(World), MEM_WORLDS);
+    if (!top) {
+        perror("Failed to allocate bot dungeon");
+        exit(EXIT_FAILURE);
+    }
+    world_init(top);
+    initialize_game(player, top);
+    place_stairs(top, 0, floor_count);
+    game->floors[0] = top;
+    top->floors_unfinished = 0;
+    for (int floor = 0; floor < floor_count; floor++) {
+        if (floor > 0) game->floors[floor] = generate_floor(floor, floor_count);
+        game->owned[floor] = 1;
+        game->unfinished[floor] = floor_unfinished(game->floors[floor]);
+        if (floor > 0) top->floors_unfinished += game->unfinished[floor];
+    }
+}
+
+// Release the floors a game copied; borrowed floors belong to its source
+static void bot_game_drop(BotGame *game) {
+    for (int floor = 0; floor < game->floor_count; floor++) {
+        if (game->owned[floor]) world_release(game->floors[floor]);
+        game->owned[floor] = 0;
+    }
+}
+
+static void bot_game_free(BotGame *game) {
+    bot_game_drop(game);
+    mem_free(game->floors);
+    mem_free(game->owned);
+    mem_free(game->unfinished);
+}
+
+// Fork a game into fork, reusing fork's arrays: only the current floor is
+// copied, the others are borrowed from game
+static void bot_game_fork(BotGame *fork, const BotGame *game) {
+    if (fork->capacity < game->floor_count) {
+        fork->floors = grow_array(fork->floors, game->floor_count, sizeof(World *), MEM_BOT);
+        fork->owned = grow_array(fork->owned, game->floor_count, 1, MEM_BOT);
+        fork->unfinished = grow_array(fork->unfinished, game->floor_count, 1, MEM_BOT);
+        fork->capacity = game->floor_count;
+    }
+    fork->floor_count = game->floor_count;
+    fork->current = game->current;
+    memcpy(fork->floors, game->floors, game->floor_count * sizeof(World *));
+    memset(fork->owned, 0, game->floor_count);
+    memcpy(fork->unfinished, game->unfinished, game->floor_count);
+    fork->floors[fork->current] = world_clone(game->floors[game->current]);
+    fork->owned[fork->current] = 1;
+}
+
+// Item to pick up in the player's room, NO_ID for none: an award first,
+// other items only while the inventory keeps room for every award not
+// carried yet, since a full inventory can't finish the dungeon
+static int bot_pickup_item(BotGame *game, Player *player) {
+    World *world = game->floors[game->current];
+    int room = find_room_at_position(world, player->x, player->y);
+    if (room == NO_ID || player->inventory_count >= MAX_INVENTORY) return NO_ID;
+    int awards_missing = content->creature_count * game->floor_count;
     for (int i = 0; i < player->inventory_count; i++) {
-        free(player->inventory[i]->name);
-        free(player->inventory[i]);
+        awards_missing -= world->item_award[player->inventory[i]];
+    }
+    int other = NO_ID;
+    for (int item = world->room_first_item[room]; item != NO_ID; item = world->item_next[item]) {
+        if (world->item_award[item]) return item;
+        if (other == NO_ID) other = item;
     }
+    return player->inventory_count + awards_missing < MAX_INVENTORY ? other : NO_ID;
 }
 
-void display_map(Room *rooms[], int room_count, Player *player) {
-    printf("Map:\n");
-    for (int i = 0; i < MAP_SIZE; i++) {
-        for (int j = 0; j < MAP_SIZE; j++) {
-            if (player->x == j && player->y == i) {
-                printf("[P]");  // Player's current position
-            } else if (i == 2 && j == 2) {
-                printf("[I]");  // Starting room
-            } else if (find_room_at_position(rooms, room_count, j, i)) {
-                printf("[R]");  // Room exists
-            } else {
-                printf("[X]");  // No room at this position
-            } 
+static int bot_is_legal(BotGame *game, Player *player, int action) {
+    World *world = game->floors[game->current];
+    int room = find_room_at_position(world, player->x, player->y);
+    switch (action) {
+    case BOT_PICKUP:
+        return bot_pickup_item(game, player) != NO_ID;
+    case BOT_ATTACK:
+        return room != NO_ID && world->room_first_creature[room] != NO_ID;
+    case BOT_RETURN:
+        return player->x != 2 || player->y != 2;
+    case BOT_STAIRS:
+        return (room != NO_ID && room == world->stairs_room) ||
+               (game->current > 0 && player->x == 2 && player->y == 2);
+    default: {
+        int x = player->x + bot_dx[action], y = player->y + bot_dy[action];
+        return x >= 0 && x < MAP_SIZE && y >= 0 && y < MAP_SIZE;
+    }
+    }
+}
+
+// Rule core of the stairs, following change_floor: carried items move to
+// the arriving floor's pool and the unfinished floor counts carry over
+static int bot_take_stairs(BotGame *game, Player *player, int verbose) {
+    World *world = game->floors[game->current];
+    int room = find_room_at_position(world, player->x, player->y);
+    int down = room != NO_ID && room == world->stairs_room;
+    int floor = game->current + (down ? 1 : -1);
+    if (!game->owned[floor]) {
+        game->floors[floor] = world_clone(game->floors[floor]);
+        game->owned[floor] = 1;
+    }
+    World *arriving = game->floors[floor];
+    for (int i = 0; i < player->inventory_count; i++) {
+        int item = player->inventory[i];
+        player->inventory[i] = world_new_item(arriving, world->item_name[item], world->item_attack[item],
+                                              world->item_shield[item]);
+        world_free_item(world, item);
+    }
+    int unfinished = floor_unfinished(world);
+    arriving->floors_unfinished = world->floors_unfinished + unfinished - game->unfinished[floor];
+    game->unfinished[game->current] = unfinished;
+    game->current = floor;
+    if (down) {
+        player->x = 2;
+        player->y = 2;
+    } else {
+        player->x = arriving->room_x[arriving->stairs_room];
+        player->y = arriving->room_y[arriving->stairs_room];
+    }
+    mark_discovered(arriving, player->x, player->y);
+    if (verbose) {
+        printf("You take the stairs %s to floor %d of %d.\n", down ? "down" : "up", floor + 1, game->floor_count);
+    }
+    return STEP_DONE;
+}
+
+static int bot_step(BotGame *game, Player *player, int action, uint64_t *rng, int verbose) {
+    World *world = game->floors[game->current];
+    switch (action) {
+    case BOT_PICKUP:
+        return step_pickup(player, world, bot_pickup_item(game, player), verbose);
+    case BOT_ATTACK:
+        return step_attack(player, world, rng, verbose);
+    case BOT_RETURN: {
+        // Walk back to the starting room, across first, then along
+        int result = STEP_DONE;
+        while (result == STEP_DONE && (player->x != 2 || player->y != 2)) {
+            int x = player->x + (player->x < 2) - (player->x > 2);
+            int y = player->x == 2 ? player->y + (player->y < 2) - (player->y > 2) : player->y;
+            result = step_move(player, world, x, y, verbose);
         }
-        printf("\n");
+        return result;
+    }
+    case BOT_STAIRS:
+        return bot_take_stairs(game, player, verbose);
+    default:
+        return step_move(player, world, player->x + bot_dx[action], player->y + bot_dy[action], verbose);
     }
 }
 
-void display_help() {
-    printf("Available commands:\n");
-    printf("- move <direction>: Move in a direction (up, down, left, right).\n");
-    printf("- look: Examine the current location.\n");
-    printf("- inventory: View your inventory.\n");
-    printf("- pickup <item>: Pick up an item in the room.\n");
-    printf("- attack: Attack the creature in the room.\n");
-    printf("- status: Display player status.\n");
-    printf("- save <filepath>: Save the game.\n");
-    printf("- load <filepath>: Load a saved game.\n");
-    printf("- list: List all saved games.\n");
-    printf("- delete <filepath>: Delete a saved game.\n");
-    printf("- map: Display the map.\n");
-    printf("- help: Display this help message.\n");
-    printf("- exit: Exit the game.\n");
+// Play one action through the rule cores and advance the floor the player
+// ends up on a tick, as a command does; returns a STEP_ result
+static int bot_apply(BotGame *game, Player *player, int action, uint64_t *rng, int verbose) {
+    int result = bot_step(game, player, action, rng, verbose);
+    world_tick(game->floors[game->current], rng);
+    return result;
 }
 
-void display_status(Player *player) {
-    int total_attack = compute_total_attack(player);
-    int total_shield = compute_total_shield(player);
-    printf("Player Status:\n");
-    printf("Health: %d\n", player->health);
-    printf("Attack Power: %d\n", total_attack);
-    printf("Shield Power: %d\n", total_shield);
+// Nearest room with an award still lying in it, or NO_ID if none
+static int bot_award_room(Player *player, World *world) {
+    int best = NO_ID, best_distance = INT_MAX;
+    for (int i = 0; i < world->item_count; i++) {
+        int room = world->item_room[i];
+        if (!world->item_award[i] || room == NO_ID) {
+            continue;
+        }
+        int distance = abs(world->room_x[room] - player->x) + abs(world->room_y[room] - player->y);
+        if (distance < best_distance) {
+            best_distance = distance;
+            best = room;
+        }
+    }
+    return best;
 }
 
-int compute_total_attack(Player *player) {
-    int total_attack = player->base_strength;
-    for (int i = 0; i < player->inventory_count; i++) {
-        total_attack += player->inventory[i]->attack_bonus;
+// First move toward a room, or NO_ID if there is none or the player is in it
+static int bot_toward_room(Player *player, World *world, int room) {
+    if (room == NO_ID) return NO_ID;
+    if (world->room_x[room] != player->x) return world->room_x[room] < player->x ? BOT_LEFT : BOT_RIGHT;
+    if (world->room_y[room] != player->y) return world->room_y[room] < player->y ? BOT_UP : BOT_DOWN;
+    return NO_ID;
+}
+
+// Rollout policy: take loot, fight half the time, and once a floor's
+// creatures are dead fetch its awards, then take the stairs down while a
+// deeper floor is unfinished, else head home and up; otherwise wander
+static int bot_rollout_action(BotGame *game, Player *player, uint64_t *rng) {
+    World *world = game->floors[game->current];
+    if (bot_is_legal(game, player, BOT_PICKUP)) return BOT_PICKUP;
+    if (bot_is_legal(game, player, BOT_ATTACK) && roll(rng, 2) == 0) return BOT_ATTACK;
+    if (world->creatures_left == 0) {
+        int action = bot_toward_room(player, world, bot_award_room(player, world));
+        if (action != NO_ID) return action;
+        int deeper = 0;
+        for (int floor = game->current + 1; floor < game->floor_count && !deeper; floor++) {
+            deeper = game->unfinished[floor];
+        }
+        if (deeper) {
+            action = bot_toward_room(player, world, world->stairs_room);
+            return action != NO_ID ? action : BOT_STAIRS;
+        }
+        if (bot_is_legal(game, player, BOT_RETURN)) return BOT_RETURN;
+        if (game->current > 0) return BOT_STAIRS;
     }
-    return total_attack;
+    int legal[BOT_ACTIONS], count = 0;
+    for (int action = BOT_UP; action <= BOT_RIGHT; action++) {
+        if (bot_is_legal(game, player, action)) legal[count++] = action;
+    }
+    return legal[roll(rng, count)];
 }
 
-int compute_total_shield(Player *player) {
-    int total_shield = 0;  // Initial shield value
+// Creatures still alive on every floor of a game
+static int bot_creatures_left(BotGame *game) {
+    int left = 0;
+    for (int floor = 0; floor < game->floor_count; floor++) {
+        left += game->floors[floor]->creatures_left;
+    }
+    return left;
+}
+
+// Score a finished rollout in [0, 1]. A win scores above 0.5, more the
+// fewer actions it took, so a certain win is still pursued directly; a
+// death is 0, and an unfinished game is scored by progress over all
+// floors and health.
+static double bot_evaluate(BotGame *game, Player *player, int result, int actions) {
+    if (result == STEP_WON) return 1.0 - 0.5 * actions / (BOT_TREE_DEPTH + BOT_ROLLOUT_DEPTH + 1);
+    if (result == STEP_LOST) return 0.0;
+    World *world = game->floors[game->current];
+    int awards = 0;
     for (int i = 0; i < player->inventory_count; i++) {
-        total_shield += player->inventory[i]->shield_bonus;
+        awards += world->item_award[player->inventory[i]];
     }
-    return total_shield;
+    int creatures = content->creature_count * game->floor_count;
+    int kills = creatures - bot_creatures_left(game);
+    int goals = creatures ? 2 * creatures : 1;
+    return 0.4 * (kills + awards) / goals + 0.1 * player->health / 100.0;
+}
+
+static int bot_new_node(BotSearch *search) {
+    if (search->node_count == search->node_capacity) {
+        search->node_capacity = search->node_capacity ? search->node_capacity * 2 : 1024;
+        search->nodes = grow_array(search->nodes, search->node_capacity, sizeof(BotNode), MEM_BOT);
+    }
+    int node = search->node_count++;
+    for (int action = 0; action < BOT_ACTIONS; action++) {
+        search->nodes[node].children[action] = NO_ID;
+    }
+    search->nodes[node].visits = 0;
+    search->nodes[node].value = 0.0;
+    return node;
+}
+
+// Pick the action to follow from a node: an untried legal action if there
+// is one, otherwise the legal child with the best UCB1 score
+static int bot_select(BotSearch *search, int node, BotGame *game, Player *player) {
+    int untried[BOT_ACTIONS], untried_count = 0;
+    int best = NO_ID;
+    double best_score = -1.0;
+    double log_visits = log(search->nodes[node].visits + 1);
+    for (int action = 0; action < BOT_ACTIONS; action++) {
+        if (!bot_is_legal(game, player, action)) continue;
+        int child = search->nodes[node].children[action];
+        if (child == NO_ID || search->nodes[child].visits == 0) {
+            untried[untried_count++] = action;
+            continue;
+        }
+        BotNode *c = &search->nodes[child];
+        double score = c->value / c->visits + BOT_EXPLORATION * sqrt(log_visits / c->visits);
+        if (score > best_score) {
+            best_score = score;
+            best = action;
+        }
+    }
+    return untried_count ? untried[roll(&search->rng, untried_count)] : best;
+}
+
+// Grow this thread's tree from the given game until the budget runs out
+static void bot_search(BotSearch *search, const Player *player, const BotGame *game, int budget, double deadline) {
+    search->node_count = 0;
+    search->rollouts = 0;
+    int root = bot_new_node(search);
+    while (deadline > 0 ? now_seconds() < deadline : search->rollouts < budget) {
+        BotGame *sim = &search->sim;
+        bot_game_fork(sim, game);
+        Player sim_player = *player;
+        int path[BOT_TREE_DEPTH + 1];
+        int depth = 0;
+        int node = root;
+        path[depth++] = node;
+
+        // Selection and expansion: follow the tree, adding one new node
+        int result = STEP_DONE;
+        int actions = 0;
+        while (result == STEP_DONE && depth <= BOT_TREE_DEPTH) {
+            int action = bot_select(search, node, sim, &sim_player);
+            result = bot_apply(sim, &sim_player, action, &search->rng, 0);
+            actions++;
+            int child = search->nodes[node].children[action];
+            int expanded = child == NO_ID;
+            if (expanded) {
+                child = bot_new_node(search);
+                search->nodes[node].children[action] = child;
+            }
+            node = child;
+            path[depth++] = node;
+            if (expanded) break;
+        }
+
+        // Rollout past the tree with the cheap policy
+        for (int step = 0; result == STEP_DONE && step < BOT_ROLLOUT_DEPTH; step++, actions++) {
+            result = bot_apply(sim, &sim_player, bot_rollout_action(sim, &sim_player, &search->rng), &search->rng, 0);
+        }
+        double value = bot_evaluate(sim, &sim_player, result, actions);
+        for (int i = 0; i < depth; i++) {
+            search->nodes[path[i]].visits++;
+            search->nodes[path[i]].value += value;
+        }
+        bot_game_drop(sim);
+        search->rollouts++;
+    }
+
+    for (int action = 0; action < BOT_ACTIONS; action++) {
+        int child = search->nodes[root].children[action];
+        search->root_visits[action] = child == NO_ID ? 0 : search->nodes[child].visits;
+        search->root_value[action] = child == NO_ID ? 0.0 : search->nodes[child].value;
+    }
+}
+
+static void bot_run_search(BotPool *pool, BotSearch *search) {
+    int budget = pool->rollouts / pool->thread_count + (search->index < pool->rollouts % pool->thread_count);
+    search->rng = mix_seed(pool->seed ^ ((uint64_t)pool->generation << 16) ^ (uint64_t)search->index);
+    bot_search(search, pool->player, pool->game, budget, pool->deadline);
+}
+
+static void *bot_worker(void *arg) {
+    BotSearch *search = arg;
+    BotPool *pool = search->pool;
+    int seen = 0;
+    pthread_mutex_lock(&pool->lock);
+    while (1) {
+        while (!pool->stop && pool->generation == seen) {
+            pthread_cond_wait(&pool->start, &pool->lock);
+        }
+        if (pool->stop) break;
+        seen = pool->generation;
+        pthread_mutex_unlock(&pool->lock);
+
+        bot_run_search(pool, search);
+
+        pthread_mutex_lock(&pool->lock);
+        if (--pool->running == 0) {
+            pthread_cond_signal(&pool->done);
+        }
+    }
+    pthread_mutex_unlock(&pool->lock);
+    return NULL;
+}
+
+static void bot_pool_start(BotPool *pool, int thread_count) {
+    pool->thread_count = thread_count;
+    for (int i = 0; i < thread_count; i++) {
+        pool->searches[i].pool = pool;
+        pool->searches[i].index = i;
+    }
+    for (; pool->started < thread_count; pool->started++) {
+        if (pthread_create(&pool->threads[pool->started], NULL, bot_worker, &pool->searches[pool->started]) != 0) {
+            perror("Failed to start bot thread");
+            break;
+        }
+    }
+    if (pool->started > 0) {
+        pool->thread_count = pool->started;
+    } else {
+        pool->thread_count = 1;  // Search on the calling thread instead
+    }
+}
+
+static void bot_pool_stop(BotPool *pool) {
+    pthread_mutex_lock(&pool->lock);
+    pool->stop = 1;
+    pthread_cond_broadcast(&pool->start);
+    pthread_mutex_unlock(&pool->lock);
+    for (int i = 0; i < pool->started; i++) {
+        pthread_join(pool->threads[i], NULL);
+    }
+    for (int i = 0; i < pool->thread_count; i++) {
+        mem_free(pool->searches[i].nodes);
+        bot_game_free(&pool->searches[i].sim);
+    }
+}
+
+// Search the given game on every pool thread and return the action whose
+// subtree was visited most across all trees
+static int bot_decide(BotPool *pool, const Player *player, const BotGame *game, int rollouts, double seconds) {
+    pool->player = player;
+    pool->game = game;
+    pool->rollouts = rollouts;
+    pool->deadline = seconds > 0 ? now_seconds() + seconds : 0;
+    if (pool->started == 0) {
+        pool->generation++;
+        bot_run_search(pool, &pool->searches[0]);
+    } else {
+        pthread_mutex_lock(&pool->lock);
+        pool->generation++;
+        pool->running = pool->started;
+        pthread_cond_broadcast(&pool->start);
+        while (pool->running > 0) {
+            pthread_cond_wait(&pool->done, &pool->lock);
+        }
+        pthread_mutex_unlock(&pool->lock);
+    }
+
+    int best = NO_ID, best_visits = -1;
+    double best_value = 0.0;
+    for (int action = 0; action < BOT_ACTIONS; action++) {
+        int visits = 0;
+        double value = 0.0;
+        for (int i = 0; i < pool->thread_count; i++) {
+            visits += pool->searches[i].root_visits[action];
+            value += pool->searches[i].root_value[action];
+        }
+        if (visits > best_visits || (visits == best_visits && value > best_value)) {
+            best = action;
+            best_visits = visits;
+            best_value = value;
+        }
+    }
+    return best;
+}
+
+// --bot [--games N] [--seed S] [--threads N] [--rollouts N | --time-ms M]
+// [--trace]: let the bot play seeded games and report its win rate
+int run_bot(int argc, char *argv[]) {
+    int games = 10, thread_count = 0, rollouts = BOT_DEFAULT_ROLLOUTS, trace = 0;
+    unsigned int seed = 1;
+    double seconds = 0;
+    for (int i = 0; i < argc; i++) {
+        if (strcmp(argv[i], "--games") == 0 && i + 1 < argc) {
+            games = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--seed") == 0 && i + 1 < argc) {
+            seed = (unsigned int)strtoul(argv[++i], NULL, 10);
+        } else if (strcmp(argv[i], "--threads") == 0 && i + 1 < argc) {
+            thread_count = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--rollouts") == 0 && i + 1 < argc) {
+            rollouts = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--time-ms") == 0 && i + 1 < argc) {
+            seconds = atof(argv[++i]) / 1e3;
+        } else if (strcmp(argv[i], "--trace") == 0) {
+            trace = 1;
+        } else {
+            printf("Usage: --bot [--games N] [--seed S] [--threads N] [--rollouts N | --time-ms M] [--trace]\n");
+            return 1;
+        }
+    }
+    if (games <= 0 || (rollouts <= 0 && seconds <= 0)) {
+        printf("Games and the decision budget must be positive.\n");
+        return 1;
+    }
+    if (thread_count <= 0) {
+#ifdef _SC_NPROCESSORS_ONLN
+        thread_count = (int)sysconf(_SC_NPROCESSORS_ONLN);
+#endif
+        if (thread_count <= 0) thread_count = 1;
+    }
+    if (thread_count > BOT_MAX_THREADS) thread_count = BOT_MAX_THREADS;
+
+    BotPool *pool = mem_calloc(1, sizeof(BotPool), MEM_BOT);
+    if (!pool) {
+        perror("Failed to allocate bot pool");
+        return 1;
+    }
+    pthread_mutex_init(&pool->lock, NULL);
+    pthread_cond_init(&pool->start, NULL);
+    pthread_cond_init(&pool->done, NULL);
+    bot_pool_start(pool, thread_count);
+
+    if (seconds > 0) {
+        printf("Bot: %d games from seed %u, %d threads, %.1f ms per decision\n", games, seed,
+               pool->thread_count, seconds * 1e3);
+    } else {
+        printf("Bot: %d games from seed %u, %d threads, %d rollouts per decision\n", games, seed,
+               pool->thread_count, rollouts);
+    }
+
+    int won = 0, lost = 0;
+    long long total_rollouts = 0, decisions = 0;
+    double search_seconds = 0;
+    for (int game = 0; game < games; game++) {
+        unsigned int game_seed = seed + game;
+        srand(game_seed);
+        BotGame dungeon_game;
+        Player player = { .nickname = "bot", .health = 100, .base_strength = 10, .x = 2, .y = 2 };
+        bot_game_start(&dungeon_game, &player);
+        pool->seed = game_seed;
+
+        int result = STEP_DONE, actions = 0;
+        while (result == STEP_DONE && actions < BOT_MAX_ACTIONS * dungeon_game.floor_count) {
+            double start = now_seconds();
+            int action = bot_decide(pool, &player, &dungeon_game, rollouts, seconds);
+            search_seconds += now_seconds() - start;
+            for (int i = 0; i < pool->thread_count; i++) {
+                total_rollouts += pool->searches[i].rollouts;
+            }
+            decisions++;
+            if (trace) printf("Bot: %s\n", bot_action_names[action]);
+            result = bot_apply(&dungeon_game, &player, action, NULL, trace);
+            actions++;
+        }
+
+        if (result == STEP_WON) won++;
+        if (result == STEP_LOST) lost++;
+        printf("Game %d (seed %u): %s after %d actions on floor %d of %d, %d creatures left, health %d\n", game + 1,
+               game_seed, result == STEP_WON ? "won" : result == STEP_LOST ? "lost" : "gave up", actions,
+               dungeon_game.current + 1, dungeon_game.floor_count, bot_creatures_left(&dungeon_game), player.health);
+        bot_game_free(&dungeon_game);
+    }
+
+    printf("Won %d of %d games (%.1f%%), lost %d, %d out of actions\n", won, games, 100.0 * won / games, lost,
+           games - won - lost);
+    if (search_seconds > 0) {
+        printf("Search: %lld rollouts in %.2f s, %.0f rollouts/s, %.2f ms per decision\n", total_rollouts,
+               search_seconds, total_rollouts / search_seconds, search_seconds * 1e3 / decisions);
+    }
+
+    bot_pool_stop(pool);
+    pthread_mutex_destroy(&pool->lock);
+    pthread_cond_destroy(&pool->start);
+    pthread_cond_destroy(&pool->done);
+    mem_free(pool);
+    free_string_table();
+    return 0;
+}
+
+// Pointer-per-room layout used before the world moved to parallel arrays,
+// kept so whole-world scans can be compared against it. It allocates with
+// plain malloc as it always did, outside the tracking allocator.
+typedef struct LegacyItem {
+    char *name;
+    int attack_bonus;
+    int shield_bonus;
+} LegacyItem;
+
+typedef struct LegacyCreature {
+    char *name;
+    int health;
+    int strength;
+} LegacyCreature;
+
+typedef struct LegacyRoom {
+    int id;
+    char *description;
+    LegacyItem *items[MAX_ITEMS];
+    int item_count;
+    LegacyCreature *creature;
+    int x, y;
+} LegacyRoom;
+
+static void report_benchmark(const char *name, double legacy_seconds, double world_seconds, long long visits) {
+    printf("%-14s pointer-per-room %7.2f ns/room   arrays %7.2f ns/room   speedup %.2fx\n", name,
+           legacy_seconds * 1e9 / visits, world_seconds * 1e9 / visits,
+           world_seconds > 0 ? legacy_seconds / world_seconds : 0.0);
+}
+
+// Build the same random world in both layouts and time whole-world scans
+int run_benchmarks(int room_count) {
+    if (room_count <= 0) {
+        printf("Usage: --bench [room_count]\n");
+        return 1;
+    }
+    int passes = 20;
+    srand(1234);
+
+    LegacyRoom **legacy = malloc((size_t)room_count * sizeof(LegacyRoom *));
+    if (!legacy) {
+        perror("Failed to allocate benchmark rooms");
+        return 1;
+    }
+    World world;
+    world_init(&world);
+
+    // Rooms, items and creatures are allocated interleaved, as initialize_game does
+    for (int i = 0; i < room_count; i++) {
+        char name[32];
+        LegacyRoom *room = calloc(1, sizeof(LegacyRoom));
+        if (!room) {
+            perror("Failed to allocate benchmark room");
+            exit(EXIT_FAILURE);
+        }
+        room->id = i;
+        room->description = strdup(room_descriptions[i % TOTAL_DESCRIPTIONS]);
+        room->x = rand() % MAP_SIZE;
+        room->y = rand() % MAP_SIZE;
+        int world_room = world_add_room(&world, room->x, room->y, intern_string(room->description));
+
+        int item_count = rand() % 3 + 1;
+        for (int j = 0; j < item_count; j++) {
+            LegacyItem *item = malloc(sizeof(LegacyItem));
+            if (!item) {
+                perror("Failed to allocate benchmark item");
+                exit(EXIT_FAILURE);
+            }
+            sprintf(name, j == 0 ? "award%d" : "item%d", i);
+            item->name = strdup(name);
+            item->attack_bonus = rand() % 5 + 1;
+            item->shield_bonus = rand() % 5 + 1;
+            room->items[room->item_count++] = item;
+            room_add_item(&world, world_room, world_new_item(&world, intern_string(name),
+                          item->attack_bonus, item->shield_bonus));
+        }
+        if (rand() % 2 == 0) {
+            room->creature = malloc(sizeof(LegacyCreature));
+            if (!room->creature) {
+                perror("Failed to allocate benchmark creature");
+                exit(EXIT_FAILURE);
+            }
+            sprintf(name, "Creature_%d", i);
+            room->creature->name = strdup(name);
+            room->creature->health = rand() % 50 + 50;
+            room->creature->strength = rand() % 10 + 5;
+            room_add_creature(&world, world_room, world_new_creature(&world, intern_string(name),
+                              room->creature->health, room->creature->strength));
+        }
+        legacy[i] = room;
+    }
+
+    printf("Benchmark: %d rooms, %d items, %d passes per scan\n", room_count, world.item_count, passes);
+    long long visits = (long long)room_count * passes;
+    volatile long long sink = 0;
+
+    // Award scan: the win check's walk over every room's items
+    double start = now_seconds();
+    for (int p = 0; p < passes; p++) {
+        long long awards = 0;
+        for (int i = 0; i < room_count; i++) {
+            for (int j = 0; j < legacy[i]->item_count; j++) {
+                awards += strncmp(legacy[i]->items[j]->name, "award", 5) == 0;
+            }
+        }
+        sink += awards;
+    }
+    double legacy_seconds = now_seconds() - start;
+    start = now_seconds();
+    for (int p = 0; p < passes; p++) {
+        long long awards = 0;
+        const unsigned char *item_award = world.item_award;
+        const int *item_room = world.item_room;
+        for (int i = 0; i < world.item_count; i++) {
+            awards += item_award[i] & (item_room[i] != NO_ID);
+        }
+        sink += awards;
+    }
+    report_benchmark("award scan", legacy_seconds, now_seconds() - start, visits);
+
+    // Stat scan: sum every item bonus and creature health, as save and combat read them
+    start = now_seconds();
+    for (int p = 0; p < passes; p++) {
+        long long total = 0;
+        for (int i = 0; i < room_count; i++) {
+            LegacyRoom *room = legacy[i];
+            for (int j = 0; j < room->item_count; j++) {
+                total += room->items[j]->attack_bonus + room->items[j]->shield_bonus;
+            }
+            if (room->creature) total += room->creature->health;
+        }
+        sink += total;
+    }
+    legacy_seconds = now_seconds() - start;
+    start = now_seconds();
+    for (int p = 0; p < passes; p++) {
+        long long total = 0;
+        for (int i = 0; i < world.item_count; i++) {
+            total += world.item_attack[i] + world.item_shield[i];
+        }
+        for (int i = 0; i < world.creature_count; i++) {
+            total += world.creature_health[i];
+        }
+        sink += total;
+    }
+    report_benchmark("stat scan", legacy_seconds, now_seconds() - start, visits);
+
+    // Position scan: read every room's position
+    start = now_seconds();
+    for (int p = 0; p < passes; p++) {
+        long long total = 0;
+        for (int i = 0; i < room_count; i++) {
+            total += legacy[i]->x * MAP_SIZE + legacy[i]->y;
+        }
+        sink += total;
+    }
+    legacy_seconds = now_seconds() - start;
+    start = now_seconds();
+    for (int p = 0; p < passes; p++) {
+        long long total = 0;
+        const int *room_x = world.room_x, *room_y = world.room_y;
+        for (int i = 0; i < world.room_count; i++) {
+            total += room_x[i] * MAP_SIZE + room_y[i];
+        }
+        sink += total;
+    }
+    report_benchmark("position scan", legacy_seconds, now_seconds() - start, visits);
+
+    // Autosave: the game loop's snapshot pause against a full synchronous save
+    Player bench_player = { .nickname = "bench", .health = 100, .base_strength = 10, .x = 2, .y = 2 };
+    SaveSnapshot snapshot;
+    start = now_seconds();
+    take_snapshot(&snapshot, &bench_player, &world);
+    double pause = now_seconds() - start;
+    start = now_seconds();
+    if (write_save_file(&snapshot, "bench_save.tmp", NULL)) {
+        printf("autosave       snapshot pause %.3f ms   full save %.3f ms\n",
+               pause * 1e3, (now_seconds() - start) * 1e3);
+        remove("bench_save.tmp");
+    }
+
+    // Save formats: size and write/read throughput of text and compressed saves
+    const char *bench_saves[] = { "bench_save.txt", "bench_save" COMPRESSED_SAVE_EXTENSION };
+    for (int i = 0; i < 2; i++) {
+        SaveSize size, read_size;
+        start = now_seconds();
+        if (!write_save_file(&snapshot, bench_saves[i], &size)) continue;
+        double write_seconds = now_seconds() - start;
+        SaveSnapshot loaded;
+        start = now_seconds();
+        int ok = read_save_file(bench_saves[i], &loaded, &read_size);
+        double read_seconds = now_seconds() - start;
+        if (ok) {
+            printf("%-14s %.1f KB on disk (stream %.2fx)   write %.1f ms, %.1f MB/s   read %.1f ms, %.1f MB/s\n",
+                   i == 0 ? "text save" : "compressed", size.file_bytes / 1024.0,
+                   (double)size.raw_bytes / size.file_bytes, write_seconds * 1e3,
+                   size.raw_bytes / write_seconds / 1e6, read_seconds * 1e3,
+                   read_size.raw_bytes / read_seconds / 1e6);
+            world_free(&loaded.world);
+        }
+        remove(bench_saves[i]);
+    }
+    world_free(&snapshot.world);
+
+    // Loot pickup: look up and remove every item of one crowded room by name
+    for (int loot = 100; loot <= room_count; loot *= 100) {
+        World loot_world;
+        world_init(&loot_world);
+        int room = world_add_room(&loot_world, 0, 0, intern_string(room_descriptions[0]));
+        for (int i = 0; i < loot; i++) {
+            char name[32];
+            sprintf(name, "item%d", i);
+            room_add_item(&loot_world, room, world_new_item(&loot_world, intern_string(name), 1, 0));
+        }
+        start = now_seconds();
+        for (int i = loot - 1; i >= 0; i--) {
+            char name[32];
+            sprintf(name, "item%d", i);
+            room_remove_item(&loot_world, room_find_item(&loot_world, room, find_string(name)));
+        }
+        double seconds = now_seconds() - start;
+        printf("loot pickup    %d items in one room: %.2f ns/pickup\n", loot, seconds * 1e9 / loot);
+        world_free(&loot_world);
+    }
+
+    // Map redraw: walk every cell of the map, redrawing after each step once
+    // from scratch and once from the cached frame, then check both agree
+    int map_bad = 0;
+    {
+        World map_world;
+        world_init(&map_world);
+        for (int i = 0; i < MAX_ROOMS; i++) {
+            world_add_room(&map_world, rand() % MAP_SIZE, rand() % MAP_SIZE, intern_string(room_descriptions[0]));
+        }
+        Player walker = bench_player;
+        double seconds[2];
+        long long rows[2] = { 0, 0 };
+        int steps = MAP_SIZE * MAP_SIZE;
+        for (int cached = 0; cached < 2; cached++) {
+            clear_discovered(&map_world);
+            invalidate_map_frame();
+            start = now_seconds();
+            for (int step = 0; step < steps; step++) {
+                walker.y = step / MAP_SIZE;
+                walker.x = walker.y % 2 == 0 ? step % MAP_SIZE : MAP_SIZE - 1 - step % MAP_SIZE;
+                mark_discovered(&map_world, walker.x, walker.y);
+                if (!cached) invalidate_map_frame();
+                rows[cached] += update_map_frame(&map_world, &walker);
+                int x0, y0;
+                int size = map_viewport(&walker, &x0, &y0);
+                sink += size + x0 + y0;
+                if (walker.x < x0 || walker.x >= x0 + size || walker.y < y0 || walker.y >= y0 + size) map_bad = 1;
+            }
+            seconds[cached] = now_seconds() - start;
+        }
+        static char cached_rows[MAP_SIZE][MAP_SIZE * MAP_CELL_WIDTH + 1];
+        memcpy(cached_rows, map_frame.rows, sizeof(cached_rows));
+        invalidate_map_frame();
+        update_map_frame(&map_world, &walker);
+        if (memcmp(cached_rows, map_frame.rows, sizeof(cached_rows)) != 0) map_bad = 1;
+        int x0, y0;
+        int size = map_viewport(&walker, &x0, &y0);
+        printf("map redraw     %dx%d cells, %d chunks, %dx%d view: full %.2f us   cached %.2f us   rows %.2f vs %.2f   %s\n",
+               MAP_SIZE, MAP_SIZE, MAP_CHUNKS * MAP_CHUNKS, size, size, seconds[0] * 1e6 / steps,
+               seconds[1] * 1e6 / steps, (double)rows[0] / steps, (double)rows[1] / steps,
+               map_bad ? "MISMATCH" : "frames match");
+        invalidate_map_frame();
+        world_free(&map_world);
+    }
+
+    // World clone: fork and release a session, as a planner does per lookahead
+    World game_world;
+    world_init(&game_world);
+    initialize_game(&bench_player, &game_world);
+    World *worlds[] = { &game_world, &world };
+    for (int i = 0; i < 2; i++) {
+        int clones = i == 0 ? 100000 : 20;
+        start = now_seconds();
+        for (int c = 0; c < clones; c++) {
+            World *clone = world_clone(worlds[i]);
+            sink += clone->room_count;
+            world_release(clone);
+        }
+        double seconds = now_seconds() - start;
+        printf("world clone    %d rooms, %d items: %.2f us/clone\n", worlds[i]->room_count,
+               worlds[i]->item_count, seconds * 1e6 / clones);
+    }
+    world_free(&game_world);
+
+    // Creature events: a crowd of creatures sharing rooms, each with a
+    // wander event up to 2^18 ticks away; ticks cost only the events due
+    World crowd;
+    world_init(&crowd);
+    int crowd_rooms = room_count / 100 > 0 ? room_count / 100 : 1;
+    for (int i = 0; i < crowd_rooms; i++) {
+        world_add_room(&crowd, i % MAP_SIZE, i / MAP_SIZE % MAP_SIZE, intern_string(room_descriptions[0]));
+    }
+    int creature_name = intern_string("Creature_0");
+    for (int i = 0; i < room_count; i++) {
+        int creature = world_new_creature(&crowd, creature_name, 100, 10);
+        room_add_creature(&crowd, i % crowd_rooms, creature);
+    }
+    start = now_seconds();
+    for (int i = 0; i < room_count; i++) {
+        world_schedule(&crowd, EVENT_WANDER, i, 1 + rand() % (1 << 18));
+    }
+    double seconds = now_seconds() - start;
+    uint64_t crowd_rng = 1;
+    int ticks = WHEEL_SLOTS * WHEEL_SLOTS;  // Crosses a level 2 cascade
+    start = now_seconds();
+    for (int t = 0; t < ticks; t++) {
+        world_tick(&crowd, &crowd_rng);
+    }
+    double tick_seconds = now_seconds() - start;
+    printf("creature tick  %d creatures in %d rooms: schedule %.2f ns/event   tick %.2f us   %lld events fired\n",
+           room_count, crowd_rooms, seconds * 1e9 / room_count, tick_seconds * 1e6 / ticks, crowd.events_fired);
+    world_free(&crowd);
+
+    // Floor streaming: walk down a deep dungeon and back up, playing briefly
+    // on each floor, while only the floors around the player stay in memory
+    World floor_world;
+    world_init(&floor_world);
+    Player floor_player = bench_player;
+    initialize_game(&floor_player, &floor_world);
+    dungeon_start(&floor_world, BENCH_FLOORS);
+    struct timespec play = { 0, BENCH_FLOOR_PLAY_US * 1000L };
+    for (int floor = 1; floor < 2 * BENCH_FLOORS - 1; floor++) {
+        nanosleep(&play, NULL);
+        change_floor(&floor_player, &floor_world, floor < BENCH_FLOORS ? floor : 2 * BENCH_FLOORS - 2 - floor);
+    }
+    printf("floor streaming %d floors down and up: %.3f ms/change, max %.3f ms, %d waited, peak %d floors in memory\n",
+           BENCH_FLOORS, dungeon.transition_total * 1e3 / dungeon.transitions, dungeon.transition_max * 1e3,
+           dungeon.stalls, dungeon.resident_max);
+    dungeon_stop();
+    world_free(&floor_world);
+
+    // Content pack: compile a pack with one description per room, then map it
+    FILE *pack_source = fopen("bench_pack.txt", "w");
+    if (pack_source) {
+        for (int i = 0; i < room_count; i++) {
+            fprintf(pack_source, "description: %s (%d)\n", room_descriptions[i % TOTAL_DESCRIPTIONS], i);
+        }
+        fclose(pack_source);
+        start = now_seconds();
+        int compiled = compile_pack("bench_pack.txt", "bench_pack.dpk") == 0;
+        double compile_seconds = now_seconds() - start;
+        start = now_seconds();
+        if (compiled && load_content("bench_pack.dpk")) {
+            double load_seconds = now_seconds() - start;
+            printf("content pack   %u descriptions: compile %.1f ms   load %.3f ms\n", content->description_count,
+                   compile_seconds * 1e3, load_seconds * 1e3);
+        }
+        load_content(CONTENT_PACK_PATH);
+        remove("bench_pack.txt");
+        remove("bench_pack.dpk");
+    }
+
+    for (int i = 0; i < room_count; i++) {
+        LegacyRoom *room = legacy[i];
+        for (int j = 0; j < room->item_count; j++) {
+            free(room->items[j]->name);
+            free(room->items[j]);
+        }
+        if (room->creature) {
+            free(room->creature->name);
+            free(room->creature);
+        }
+        free(room->description);
+        free(room);
+    }
+    free(legacy);
+    world_free(&world);
+    free_string_table();
+    return sink == 0 || map_bad;  // sink keeps the scans from being optimized away
 }